@@ -1,5 +1,7 @@
 # Run with: python3 build.py
 import os
+import sys
+import glob
 import platform
 
 # (1)==================== COMMON CONFIGURATION OPTIONS ======================= #
@@ -14,11 +16,14 @@ EXECUTABLE="project"        # Name of the final executable
 ARGUMENTS=""            # Arguments needed for our program (Add others as you see fit)
 INCLUDE_DIR=""          # Which directories do we want to include.
 LIBRARIES=""            # What libraries do we want to include
+TEST_LIBRARIES=""       # What libraries the tests need, which draw without SDL
+TEST_SUFFIX=""          # What test executables end with
 
 if platform.system()=="Linux":
     ARGUMENTS="-D LINUX" # -D is a #define sent to preprocessor
     INCLUDE_DIR="-I ./include/ -I ./glm/"
     LIBRARIES="-lSDL2 -ldl"
+    TEST_LIBRARIES="-ldl -pthread"
 elif platform.system()=="Darwin":
     ARGUMENTS="-D MAC" # -D is a #define sent to the preprocessor.
     INCLUDE_DIR="-I ./include/ -I/Library/Frameworks/SDL2.framework/Headers -I./glm"
@@ -27,10 +32,59 @@ elif platform.system()=="Windows":
     ARGUMENTS="-D MINGW -static-libgcc -static-libstdc++" 
     INCLUDE_DIR="-I./include/ -I./glm/"
     EXECUTABLE="project.exe"
+    TEST_SUFFIX=".exe"
     LIBRARIES="-lmingw32 -lSDL2main -lSDL2 -mwindows"
 # (2)=================== Platform specific configuration ===================== #
 
-# (3)====================== Building the Executable ========================== #
+# (3)================== Building the Tests and Benchmarks ===================== #
+# Run with: python3 build.py tests    (builds and runs every tests/*_test.cpp)
+#      or:  python3 build.py bench    (builds and runs every tests/*_bench.cpp)
+# Each one links the game's sources except main.cpp, along with the other files
+# in tests/, which stand in for the window and the GL driver. The sources are
+# compiled once into build/ and only again when they or a header change.
+# Tests and benchmarks are optimized, so that the benchmarks measure what ships.
+TEST_COMPILER="g++ -O2 -g -std=c++17"
+TEST_BUILD_DIR="./build/"
+
+def newer(target, sources):
+    return not os.path.exists(target) or any(os.path.getmtime(source) > os.path.getmtime(target) for source in sources)
+
+def buildTests(suffix):
+    os.makedirs(TEST_BUILD_DIR, exist_ok=True)
+    headers = glob.glob("./include/*.hpp") + glob.glob("./tests/*.hpp")
+    programs = sorted(glob.glob("./tests/*"+suffix))
+    support = [source for source in sorted(glob.glob("./tests/*.cpp")) if not source.endswith(("_test.cpp", "_bench.cpp"))]
+    sources = [source for source in sorted(glob.glob(SOURCE)) if os.path.basename(source) != "main.cpp"] + support
+    objects = []
+    for source in sources:
+        object = TEST_BUILD_DIR+os.path.basename(source)[:-len(".cpp")]+".o"
+        objects.append(object)
+        if newer(object, [source] + headers):
+            command = TEST_COMPILER+" "+ARGUMENTS+" -c "+source+" -o "+object+" "+INCLUDE_DIR+" -I ./tests/"
+            print(command)
+            if os.system(command) != 0:
+                return 1
+    failed = []
+    for program in programs:
+        executable = TEST_BUILD_DIR+os.path.basename(program)[:-len(".cpp")]+TEST_SUFFIX
+        command = TEST_COMPILER+" "+ARGUMENTS+" "+program+" "+" ".join(objects)+" -o "+executable+" "+INCLUDE_DIR+" -I ./tests/ "+TEST_LIBRARIES
+        print(command)
+        if os.system(command) != 0 or os.system(executable) != 0:
+            failed.append(program)
+    print("===============================================================================")
+    print(str(len(programs) - len(failed))+" of "+str(len(programs))+" passed")
+    for program in failed:
+        print("\tfailed: "+program)
+    return 1 if failed else 0
+
+if len(sys.argv) > 1:
+    if sys.argv[1] not in ("tests", "bench"):
+        print("usage: python3 build.py [tests|bench]")
+        exit(1)
+    exit(buildTests("_test.cpp" if sys.argv[1] == "tests" else "_bench.cpp"))
+# (3)================== Building the Tests and Benchmarks ===================== #
+
+# (4)====================== Building the Executable ========================== #
 # Build a string of our compile commands that we run in the terminal
 compileString=COMPILER+" "+ARGUMENTS+" "+SOURCE+" -o "+EXECUTABLE+" "+" "+INCLUDE_DIR+" "+LIBRARIES
 # Print out the compile string
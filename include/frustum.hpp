@@ -0,0 +1,42 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// an axis aligned box in world space
+struct AABB {
+  glm::vec3 min = glm::vec3(0);
+  glm::vec3 max = glm::vec3(0);
+};
+
+// the six planes bounding what a camera sees. each is (normal, distance) with the normal
+// pointing inward and of unit length, so dot(normal, point) + distance is how far a point is
+// inside it
+struct Frustum {
+  glm::vec4 planes[6];
+};
+
+// the frustum of a projection * view matrix, from the rows of the matrix as in Gribb and
+// Hartmann's "Fast Extraction of Viewing Frustum Planes"
+Frustum extractFrustum(const glm::mat4 &projectionView);
+
+// whether any part of a box could be inside a frustum. boxes near a corner of the frustum
+// can pass without being inside, which only costs drawing them
+bool intersectsFrustum(const Frustum &frustum, const AABB &box);
+
+// boxes laid out by component, so they can be tested against a frustum four at a time
+class AABBBatch {
+  private:
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+  public:
+    void clear();
+    void add(const AABB &box);
+    size_t size() const;
+    // set visible[i] to 1 if box i intersects the frustum and 0 if not, as intersectsFrustum
+    // would, and return how many do
+    size_t cull(const Frustum &frustum, std::vector<uint8_t> &visible) const;
+};
+
+#endif
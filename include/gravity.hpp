@@ -1,6 +1,7 @@
 #include <glm/glm.hpp>
 #include <glm/vec3.hpp>
 
+#include <string>
 #include <vector>
 #include <unordered_map>
 
@@ -0,0 +1,37 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+#include <vector>
+#include <glm/glm.hpp>
+#include "frustum.hpp"
+
+// a small depth buffer drawn on the CPU from a few large occluders, which boxes are then tested
+// against before anything behind them is sent to the GPU. depths are z / w in clip space
+class OcclusionBuffer {
+  private:
+    int width = 0;
+    int height = 0;
+    // rows are padded to a multiple of 4 pixels, so they can be worked on 4 at a time
+    int stride = 0;
+    std::vector<float> depths;
+    glm::mat4 projectionView;
+    // draw a convex quad already in screen space, with x and y in pixels, into the pixels it
+    // covers whole. quads are drawn whole rather than as two triangles, so the pixels along
+    // their diagonal aren't left out
+    void rasterizeConvex(glm::vec3 corners[4]);
+  public:
+    OcclusionBuffer(int width, int height);
+    // empty the buffer for a new view
+    void clear(const glm::mat4 &projectionView);
+    // draw a flat quad from its corners in world space, in order around its edge. quads that
+    // reach behind the near plane are left out rather than clipped
+    void rasterizeQuad(const glm::vec3 corners[4]);
+    // whether any part of a box could be in front of what has been drawn. boxes reaching
+    // behind the near plane always could
+    bool visible(const AABB &box) const;
+    int getWidth() const;
+    int getHeight() const;
+    // the depth at a pixel, counted from the bottom left, for inspecting the buffer
+    float getDepth(int x, int y) const;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+#include <atomic>
+
+// a lock-free queue that any number of threads push to and a single thread pops from.
+// items link through their own next pointer, so pushing never allocates or blocks
+template <typename T>
+class MPSCQueue {
+  private:
+    // the most recently pushed item, linking back to the ones pushed before it
+    std::atomic<T*> head = {nullptr};
+    // items taken off the head, in the order they were pushed. only the consumer touches these
+    T* pending = nullptr;
+  public:
+    void push(T* item) {
+      T* last = head.load(std::memory_order_relaxed);
+      do {
+        item->next = last;
+      } while (!head.compare_exchange_weak(last, item, std::memory_order_release, std::memory_order_relaxed));
+    }
+    // the oldest item, or nullptr if the queue is empty. only call from the consumer thread
+    T* pop() {
+      if (pending == nullptr) {
+        // take everything pushed so far at once and reverse it into the order it was pushed
+        T* item = head.exchange(nullptr, std::memory_order_acquire);
+        while (item != nullptr) {
+          T* next = item->next;
+          item->next = pending;
+          pending = item;
+          item = next;
+        }
+      }
+      T* item = pending;
+      if (item != nullptr) {
+        pending = item->next;
+      }
+      return item;
+    }
+};
+
+#endif
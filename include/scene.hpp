@@ -1,7 +1,10 @@
 #include <vector>
 #include <unordered_map>
+#include <map>
 #include <string>
 #include <iostream>
+#include <cstring>
+#include <cstdint>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -11,6 +14,8 @@
 #include "obj.hpp"
 #include "Texture.hpp"
 #include "Camera.hpp"
+#include "frustum.hpp"
+#include "occlusion.hpp"
 
 // vvvvvvvvvvvvvvvvvvv Error Handling Routines vvvvvvvvvvvvvvv
 static void GLClearAllErrors(){
@@ -60,9 +65,10 @@ GLuint CreateShaderProgram(const std::string& vertexShaderSource, const std::str
 /**
 * Create the graphics pipeline
 *
+* @param defines preprocessor lines to compile both shaders with, after their #version
 * @return void
 */
-GLuint CreateGraphicsPipeline();
+GLuint CreateGraphicsPipeline(const std::string& defines = "");
 
 // a structure representing a vertex entry in a VBO
 struct VBOVertex {
@@ -92,19 +98,159 @@ namespace std {
   template<>
   struct hash<VBOVertex> {
     inline size_t operator()(const VBOVertex& x) const {
-      return x.x + x.y * 3 + x.z * 5
-          + x.nx * 17 + x.ny * 19 + x.nz * 23
-          + x.tx * 29 + x.ty * 31;
+      // mix the bits of every float, so vertices a fraction apart don't share a bucket.
+      // adding 0 turns -0 into 0, as the two compare equal and so must hash the same
+      const float fields[8] = {x.x + 0.0f, x.y + 0.0f, x.z + 0.0f, x.nx + 0.0f, x.ny + 0.0f, x.nz + 0.0f, x.tx + 0.0f, x.ty + 0.0f};
+      uint64_t h = 14695981039346656037ull;
+      for (float field : fields) {
+        uint32_t bits;
+        std::memcpy(&bits, &field, sizeof(bits));
+        h = (h ^ bits) * 1099511628211ull;
+      }
+      // FNV leaves the low bits depending only on the low bits of each float, which are
+      // mostly zero for block-aligned positions, so spread the high bits back down
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdull;
+      h ^= h >> 33;
+      return h;
     }
   };
 }
 
-bool encodeOBJ(OBJModel model, std::vector<VBOVertex> &data, std::vector<GLuint> &indices);
+// the passes chunk meshes are split into, drawn in this order
+enum RenderPass {
+  // blocks that cover their whole face, drawn without discarding so early depth testing stays on
+  PASS_OPAQUE,
+  // blocks with holes in their texture, whose white texels are discarded
+  PASS_CUTOUT,
+  // blocks blended over what lies behind them, drawn back to front after everything else
+  PASS_TRANSLUCENT
+};
+const int RENDER_PASSES = 3;
+
+// world units per block of a chunk vertex. must match BLOCK_SCALE and blockScale in the shaders
+const float CHUNK_VERTEX_SCALE = 0.5f;
+
+// a chunk vertex packed into 8 bytes. the position is a block corner relative to the chunk's
+// origin, so each axis spans 0 to CHUNK_SIZE, and the normal and texture follow from the rest
+struct ChunkVertex {
+  uint8_t x, y, z;
+  // index into ORTHO_DIRS
+  uint8_t normal;
+  uint8_t blockType;
+  // index into SQUARE_OFFSETS
+  uint8_t corner;
+  // the ChunkArena slot of the mesh holding the vertex, low byte first, set as it is uploaded
+  uint8_t slot[2] = {0, 0};
+  ChunkVertex(glm::ivec3 position, int normalIndex, uint8_t type, int cornerIndex) {
+    x = position.x;
+    y = position.y;
+    z = position.z;
+    normal = normalIndex;
+    blockType = type;
+    corner = cornerIndex;
+  }
+  void setSlot(int index) {
+    slot[0] = uint8_t(index);
+    slot[1] = uint8_t(index >> 8);
+  }
+  // the slot as the vertex shader reads it
+  int getSlot() const {
+    return slot[0] | slot[1] << 8;
+  }
+};
+
+// encode an OBJ into VBO data, splitting faces with more than three vertices into fans
+bool encodeOBJ(const OBJModel &model, std::vector<VBOVertex> &data, std::vector<GLuint> &indices);
+
+// reorder triangles so they reuse vertices still in the GPU's post-transform cache, scoring
+// vertices by how recently they were used and how few triangles still need them
+void optimizeVertexCache(std::vector<GLuint> &indices, size_t vertexCount);
+
+// split triangles in cache order into clusters, cutting where the cache would be cold
+// anyway or the cluster's own miss ratio allows, and draw the clusters facing most away
+// from the mesh's center first, as they tend to hide the rest. threshold is how much worse
+// than the original a cluster's cache miss ratio may get
+void optimizeOverdraw(std::vector<GLuint> &indices, const std::vector<VBOVertex> &data, float threshold = 1.05f);
+
+// a copy of an OBJ with its faces split into triangles and reordered for the vertex cache
+// and overdraw. the order survives scaling and offsetting, so meshes only do this once
+OBJModel optimizeOBJ(const OBJModel &model);
+
+// how many quads packed meshes leave room for, so most edits fit in their buffers
+const size_t PACKED_MESH_SPARE_QUADS = 64;
+
+// the indices of each quad of a packed mesh relative to its first vertex, which are TRI1 then
+// TRI2. every packed mesh draws with one shared buffer of them instead of its own
+const int QUAD_INDEX_PATTERN[6] = {0, 1, 2, 1, 3, 2};
+// how many quads 16 bit indices reach
+const size_t SHORT_INDEX_QUADS = 16384;
 
 struct RenderCache {
   std::vector<VBOVertex> vertices;
+  // packed chunk meshes leave these empty, as they share the scene's quad indices
   std::vector<GLuint> indices;
   std::string texture;
+  // whether texture coordinates mark the corner of an atlas tile that repeats once per block
+  bool tiled = false;
+  // packed chunk meshes fill these instead of vertices, offset by origin in blocks
+  std::vector<ChunkVertex> chunkVertices;
+  glm::vec3 origin = {0, 0, 0};
+  // how many of the chunk vertices each pass has facing each of ORTHO_DIRS, laid out one
+  // after another in that order
+  size_t faceVertices[RENDER_PASSES][6] = {};
+};
+
+// the world space box around a cache's vertices, packed or not
+AABB cacheBounds(const RenderCache &cache);
+
+// the directions of ORTHO_DIRS that faces of a chunk can point toward a point from, as bits.
+// the point is relative to the chunk origin in blocks
+uint8_t facingDirections(glm::vec3 eye);
+
+// how many vertices the chunk arena starts with room for. it doubles whenever it runs out
+const size_t CHUNK_ARENA_VERTICES = 1 << 20;
+// how many packed meshes the arena holds at most, as many as ChunkVertex::slot can number
+const size_t CHUNK_ARENA_SLOTS = 1 << 16;
+// the texture unit the vertex shader reads chunk origins through, past those textures load into
+const int CHUNK_ORIGIN_TEXTURE_UNIT = 15;
+
+// one vertex buffer that every packed mesh takes a range of, so that all of them draw through
+// the same vertex array in one multi-draw call. each range also holds a slot numbering the
+// chunk origin its vertices are placed from, which the vertex shader looks up
+class ChunkArena {
+  private:
+    GLuint vbo = 0;
+    GLuint vao = 0;
+    // in vertices
+    size_t capacity = 0;
+    // the unused ranges as first vertex and count, merged with their neighbors as they are freed
+    std::map<size_t, size_t> freeRanges;
+    // the chunk origin of each slot as a buffer texture, and the slots not in use
+    GLuint originBuffer = 0;
+    GLuint originTexture = 0;
+    std::vector<uint16_t> freeSlots;
+    // the index buffer the vertex array draws with
+    GLuint elementBuffer = 0;
+    // move the vertices to a buffer with room for at least this many
+    void grow(size_t vertices);
+  public:
+    struct Range {
+      size_t first = 0;
+      size_t count = 0;
+      int slot = -1;
+    };
+    ChunkArena();
+    ~ChunkArena();
+    // a range of count vertices placed from a chunk origin in blocks
+    Range allocate(size_t count, glm::vec3 origin);
+    // hand a range back, leaving it empty
+    void release(Range &range);
+    // copy vertices into a range from offset vertices into it, first marking them with its slot
+    void write(const Range &range, size_t offset, ChunkVertex* vertices, size_t count);
+    // bind the vertex array drawing from the arena with a buffer of quad indices, and the
+    // chunk origins for the vertex shader
+    void bind(GLuint quadIndices);
 };
 
 class Mesh {
@@ -113,22 +259,49 @@ class Mesh {
     size_t vboSize = 0;
     GLuint buffer = 0;
     size_t bufferSize = 0;
+    // packed meshes keep their vertices in a range of the arena instead, with room to grow
+    ChunkArena* arena = nullptr;
+    ChunkArena::Range range;
     OBJModel baseModel;
+    bool tiled = false;
+    // the scene's material for the texture and tiling, which every draw of the mesh binds
+    uint32_t material = 0;
+    bool packed = false;
+    glm::vec3 chunkOrigin;
+    // the box around the vertices in world space, for culling
+    AABB bounds;
+    // whether the mesh is known to be out of sight wherever the camera looks
+    bool occluded = false;
+    size_t faceVertices[RENDER_PASSES][6] = {};
+    // a copy of the translucent vertices, resorted as the camera moves
+    std::vector<ChunkVertex> translucentVertices;
+    // where the camera was when they were last sorted, relative to the chunk origin in blocks
+    glm::vec3 sortedFrom;
+    bool sorted = false;
     float scale;
     glm::vec3 position;
     void initializeVAO(GLuint vao);
+    void setPasses(RenderCache &cache);
   public:
     Mesh(GLuint vao, OBJModel model);
-    Mesh(GLuint vao, RenderCache cache);
+    // packed caches are kept in the arena, and have no buffers of their own
+    Mesh(RenderCache &cache, ChunkArena &arena);
 
     void clearBuffers();
 
-    void setVBOfromOBJ(OBJModel model);
+    void setVBOfromOBJ(const OBJModel &model);
 
     void setVBO(RenderCache &cache);
 
+    // rewrite a packed mesh's vertices from firstVertex on in place, moving them to a new
+    // range only if the mesh outgrew its own
+    void updateVBO(RenderCache &cache, size_t firstVertex);
+
     GLuint getVBO();
 
+    // where a packed mesh's vertices start in the arena
+    size_t getFirstVertex();
+
     size_t getVBOSize();
 
     GLuint getElementBuffer();
@@ -137,6 +310,33 @@ class Mesh {
 
     glm::vec3 getPosition();
 
+    bool isTiled();
+
+    uint32_t getMaterial();
+
+    void setMaterial(uint32_t id);
+
+    bool isPacked();
+
+    glm::vec3 getChunkOrigin();
+
+    AABB getBounds();
+
+    bool isOccluded();
+
+    void setOccluded(bool hidden);
+
+    // the vertices of a pass of a packed mesh, as an offset and count
+    size_t getPassStart(RenderPass pass);
+    size_t getPassVertices(RenderPass pass);
+    // how many of a pass's vertices face along one of ORTHO_DIRS
+    size_t getFaceVertices(RenderPass pass, int direction);
+
+    // order the translucent quads of a packed mesh back to front, as seen from a point
+    // relative to the chunk origin in blocks. skipped while the camera stays near where it
+    // was last sorted from
+    void sortTranslucent(glm::vec3 eye);
+
     void updateModel();
 
     void setScale(float factor);
@@ -169,43 +369,224 @@ struct Sun {
   // TODO: could add some specular/ambient field here too
 };
 
+// how many point lights and suns the shaders light with, which must match lightCount and
+// sunCount in the shaders. lights past these are left out
+const int MAX_POINT_LIGHTS = 1;
+const int MAX_SUNS = 1;
+// the uniform buffer binding every program reads FrameUniforms from
+const GLuint FRAME_UNIFORMS_BINDING = 0;
+
+// the camera and lights every pass shares, uploaded once a frame. laid out as the std140
+// FrameUniforms block in the shaders, where each vec3 starts on 16 bytes
+struct FrameUniforms {
+  glm::mat4 viewMatrix;
+  glm::mat4 projection;
+  glm::vec3 viewPosition;
+  float padding;
+  struct {
+    glm::vec3 lightColor;
+    float ambientIntensity;
+    glm::vec3 lightPos;
+    float specularStrength;
+  } pointLights[MAX_POINT_LIGHTS];
+  struct {
+    glm::vec3 color;
+    float padding;
+    glm::vec3 direction;
+    float padding2;
+  } suns[MAX_SUNS];
+};
+
+// the uniforms of a program set while drawing, looked up once after it is linked
+struct PipelineUniforms {
+  GLint tiledTexture;
+  GLint packedChunk;
+  GLint instanced;
+};
+
+// the first of the four vertex attributes holding the model matrix of each instance
+const GLuint INSTANCE_MATRIX_ATTRIBUTE = 5;
+// how many model matrices the instance buffer starts with room for. it doubles whenever a frame
+// queues more
+const size_t INSTANCE_BUFFER_MATRICES = 1024;
+
+// how many meshes the last frame drew, how many it left out for being outside the view, how
+// many were left out before that for being occluded, and how many in view were behind occluders.
+// state changes count the programs and materials it switched to
+struct FrameStats {
+  size_t drawn = 0;
+  size_t culled = 0;
+  size_t occluded = 0;
+  size_t hidden = 0;
+  size_t stateChanges = 0;
+};
+
+// names a mesh in a scene. the generation tells a handle to a deleted mesh apart from one to
+// whatever mesh reused its slot since, and the default handle names no mesh at all
+struct MeshHandle {
+  uint32_t index = 0;
+  uint32_t generation = 0;
+};
+
+// a texture and how meshes lay it out, bound once for every mesh sharing both
+struct Material {
+  // null for meshes without a texture, which draw with whatever is bound
+  Texture* texture = nullptr;
+  bool tiled = false;
+};
+
+// one pass of a mesh to draw, queued under a key that sorts it into place in the frame
+struct DrawItem {
+  uint64_t key;
+  Mesh* mesh;
+};
+
+// the sort key of a draw, ordered by pass, then packed meshes before the rest, then by material
+// and then nearest first, so each material is bound once and near faces hide far ones early.
+// translucent draws blend, so they go farthest first whatever their material. distance is
+// squared from the camera
+uint64_t drawKey(RenderPass pass, bool packed, uint32_t material, float distance);
+// the pass a draw was queued for
+RenderPass drawKeyPass(uint64_t key);
+
+// how many pixels across the occlusion buffer is, with as many down as keep the screen's shape
+const int OCCLUSION_WIDTH = 128;
+
 class Scene {
   private:
+    // the program of each pass, and the one in use
+    GLuint pipelines[RENDER_PASSES];
     GLuint pipeline;
+    PipelineUniforms pipelineUniforms[RENDER_PASSES];
+    PipelineUniforms* uniforms;
+    // look up a program's uniforms, set the ones that never change and bind its FrameUniforms
+    PipelineUniforms resolveUniforms(GLuint program);
+    GLuint frameUniformBuffer;
+    FrameUniforms frameUniforms;
     int width, height;
     Camera &camera;
     float fov;
+    // the far plane of the projection, in world units
+    float viewDistance;
     GLuint vao;
+    // the quad indices every packed mesh draws with. 16 bit indices cover meshes of up to
+    // SHORT_INDEX_QUADS quads, and larger ones use the 32 bit buffer, made once one needs it
+    GLuint quadIndices = 0;
+    GLuint wideQuadIndices = 0;
+    size_t wideQuadCapacity = 0;
+    void reserveWideQuadIndices(size_t quads);
     glm::vec3 background;
-    std::unordered_map<std::string, Mesh*> meshes;
+    // every mesh, packed together for drawing, and the slots handles find them through.
+    // slots of deleted meshes are reused, each time with a new generation
+    struct MeshEntry {
+      Mesh* mesh;
+      // the slot naming this entry
+      uint32_t slot;
+      bool hidden;
+    };
+    struct MeshSlot {
+      uint32_t generation;
+      // where the mesh is in meshes while the slot is in use
+      uint32_t entry;
+    };
+    std::vector<MeshEntry> meshes;
+    std::vector<MeshSlot> meshSlots;
+    std::vector<uint32_t> freeMeshSlots;
+    MeshHandle addMesh(Mesh* mesh);
+    // the entry of the mesh a handle names, or nullptr once it is deleted
+    MeshEntry* findMesh(MeshHandle handle);
     std::unordered_map<std::string, PointLight*> lights;
     std::unordered_map<std::string, Sun*> suns;
     std::unordered_map<std::string, Texture*> textures;
-    std::unordered_set<std::string> hiddenMeshes;
+    // every texture and tiling meshes have been created with. the first is no texture at all
+    std::vector<Material> materials;
+    // the material for a texture path, loading the texture the first time it is seen
+    uint32_t findMaterial(const std::string &texture, bool tiled);
     void setupVertexArrayObject();
+    // the camera's matrices and what they see, set by predraw for the frame
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    Frustum frustum;
     void predraw();
-    GLint checkedUniformLocation(std::string uniformName);
-    void setPointLightUniform(PointLight light, int index);
-    void setSunUniform(Sun sun, int index);
+    // the shown meshes whose bounds touch the frustum, gathered once for every pass
+    std::vector<Mesh*> visibleMeshes;
+    AABBBatch meshBounds;
+    std::vector<uint8_t> meshVisible;
+    FrameStats frameStats;
+    // models uploaded once and drawn as many times each frame as they have instances queued
+    struct InstancedModel {
+      Mesh* mesh;
+      uint32_t material;
+      std::vector<glm::mat4> instances;
+    };
+    std::vector<InstancedModel> models;
+    // the model matrices of every instance drawn in a frame, written anew each frame
+    GLuint instanceBuffer = 0;
+    size_t instanceCapacity = 0;
+    // draw the instances queued for every model with the cutout program, then forget them
+    void drawInstances();
+    // the quads set by setOccluders, drawn into the buffer each frame before testing meshes against it
+    std::vector<glm::vec3> occluders;
+    OcclusionBuffer occlusion;
+    void cullMeshes();
+    // every pass of the visible meshes, sorted into the order the frame draws them
+    std::vector<DrawItem> renderQueue;
+    void queueDraws();
+    // the pass and material bound while drawing the frame, or -1 before any is
+    int boundPass;
+    int64_t boundMaterial;
+    // switch to a pass or bind a material, counting it if it wasn't already in use
+    void switchPass(RenderPass pass);
+    void switchMaterial(uint32_t id);
+    // switch to the program of a pass
+    void usePass(RenderPass pass);
+    // the camera relative to the world origin in blocks, as chunk vertices measure it
+    glm::vec3 chunkEye;
+    // where packed meshes keep their vertices
+    ChunkArena chunkArena;
+    // the draws gathered for one multi-draw call of packed meshes
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void*> drawOffsets;
+    std::vector<GLint> drawBaseVertices;
+    // draw a pass of packed meshes sharing the bound material in order, leaving out the
+    // directions that face away from the camera, in one call
+    void drawChunks(const std::vector<Mesh*> &chunks, RenderPass pass);
+    // draw the whole of a mesh that isn't packed
+    void drawMesh(Mesh* mesh);
   public:
     Scene(int width, int height, Camera &camera);
     ~Scene();
     void setBackground(glm::vec3 color);
-    bool createMesh(std::string name, OBJModel obj);
-    bool createMeshFromCache(std::string name, RenderCache cache);
-    void hideMesh(std::string name);
-    void showMesh(std::string name);
-    bool meshHidden(std::string name);
-    Mesh* getMesh(std::string name);
-    void deleteMesh(std::string name);
+    // optimize reorders the model's triangles first, which is worth it for large loaded models
+    MeshHandle createMesh(OBJModel obj, bool optimize = false);
+    MeshHandle createMeshFromCache(RenderCache &cache);
+    // update a mesh whose vertices before firstVertex are unchanged, or create it if the handle
+    // names none. returns the handle of the mesh updated or created
+    MeshHandle updateMeshFromCache(MeshHandle handle, RenderCache &cache, size_t firstVertex);
+    void hideMesh(MeshHandle handle);
+    void showMesh(MeshHandle handle);
+    bool meshHidden(MeshHandle handle);
+    // nullptr if the handle names no mesh
+    Mesh* getMesh(MeshHandle handle);
+    void deleteMesh(MeshHandle handle);
+    // upload a model to draw instances of, returning its id
+    uint32_t createModel(OBJModel obj);
+    // draw an instance of a model in the next frame, placed by a model matrix
+    void addInstance(uint32_t model, const glm::mat4 &transform);
     bool createLight(std::string name, PointLight light);
     bool createSun(std::string name, Sun sun);
     PointLight* getLight(std::string name);
     Sun* getSun(std::string name);
     void deleteLight(std::string name);
+    // fill the frame's uniform buffer with the camera and lights, once predraw has set the camera
     void uploadUniforms();
     void draw();
+    FrameStats getFrameStats();
+    // the corners of flat quads in world space, four each in order around their edges, that
+    // hide meshes wholly behind them from the next frame on
+    void setOccluders(const std::vector<glm::vec3> &corners);
     void setFOV(float newFOV);
+    void setViewDistance(float distance);
 };
 
 // get the uniform location and run generic checks
@@ -1,7 +1,13 @@
 #ifndef WORLD_H
 #define WORLD_H
 #include <cstdlib> 
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include "scene.hpp"
+#include "queue.hpp"
 
 /**
  *  ---------- Global Constants ----------
@@ -25,6 +31,19 @@ const uint8_t BLOCKTYPE_PLANKS = 9;
 
 const uint8_t BLOCKTYPE_WATER = 16;
 
+// the pass a block type is drawn in. only opaque blocks hide the faces behind them
+RenderPass blockRenderPass(uint8_t blockType);
+
+// the shape of the terrain band around which noise decides between air and ground
+const float TERRAIN_GROUND_LEVEL = -6;
+const float TERRAIN_RUGGEDNESS = 16;
+
+// the largest absolute value a unit-gradient 3D perlin sample can take: sqrt(3) / 2
+const float PERLIN_AMPLITUDE = 0.8660254f;
+// the largest absolute value a 3D simplex sample can take. searching 2e8 points with every
+// corner's gradient chosen adversarially peaks at 0.979, so this leaves some margin
+const float SIMPLEX_AMPLITUDE = 1.0f;
+
 // represents orthogonal directions along the x, y, or z axis
 const glm::ivec3 POSX = {1, 0, 0};
 const glm::ivec3 NEGX = {-1, 0, 0};
@@ -42,12 +61,35 @@ const int TRI2[3] = {1, 3, 2};
  *  ---------- World Representation ----------
  */
 
+// which faces of a chunk reach which others through blocks that can be seen through, as a 6x6
+// matrix of bits in the order of ORTHO_DIRS. bit a * 6 + b is set when face a reaches face b.
+// above those, bit SOLID_FACE_BIT + d is set when every block on face d is opaque
+typedef uint64_t ChunkConnections;
+const ChunkConnections ALL_FACES_CONNECTED = (1ull << 36) - 1;
+const int SOLID_FACE_BIT = 36;
+const ChunkConnections ALL_FACES_SOLID = 0x3Full << SOLID_FACE_BIT;
+
+inline bool facesConnect(ChunkConnections connections, int a, int b) {
+  return connections >> (a * 6 + b) & 1;
+}
+
+inline bool faceSolid(ChunkConnections connections, int d) {
+  return connections >> (SOLID_FACE_BIT + d) & 1;
+}
+
 // chunks are cubic pieces of the world composed of multiple blocks
 struct Chunk {
   uint8_t blocks[CHUNK_SIZE][CHUNK_SIZE][CHUNK_SIZE];
   std::unordered_set<std::string> entityNames;
 
-  OBJModel calculateChunkOBJ();
+  // neighbors are the adjacent chunks in the order of ORTHO_DIRS, or nullptr if absent.
+  // the mesh is overwritten, reusing whatever buffers it already holds
+  void calculateChunkMesh(glm::ivec3 chunkCoordinate, Chunk* neighbors[6], RenderCache &mesh);
+  // a copy of the chunk at a coarser level of detail, where each cube 2^level blocks wide
+  // is filled with a single block type
+  Chunk downsample(int level);
+  // which of the chunk's faces see each other through its air, leaves and water
+  ChunkConnections calculateConnections();
   static bool inBounds(glm::ivec3 localBlockCoordinate) {
     int x = localBlockCoordinate.x;
     int y = localBlockCoordinate.y;
@@ -57,9 +99,6 @@ struct Chunk {
   uint8_t getBlock(glm::ivec3 localBlockCoordinate) {
     return blocks[localBlockCoordinate.z][localBlockCoordinate.y][localBlockCoordinate.x];
   }
-  static std::string id(glm::ivec3 chunkCoordinate) {
-    return std::to_string(chunkCoordinate.x) + "," + std::to_string(chunkCoordinate.y) + "," + std::to_string(chunkCoordinate.z);
-  }
 };
 
 struct Hitbox {
@@ -96,7 +135,9 @@ class Entity {
     // tell the entity to jump during the next update
     void jump();
     Hitbox getHitbox();
-    virtual OBJModel getModel();
+    // the model the entity is drawn with, scaled to its hitbox. it is built once and shared by
+    // every entity of its kind
+    virtual const OBJModel& getModel();
     friend class EntityGod;
 };
 
@@ -104,7 +145,7 @@ class Player: public Entity {
   public:
     Player(std::string entityName, glm::vec3 initialPosition, float facing, glm::vec3 initialVelocity);
     //TODO: remember that overriding doesn't work unless we pass pointers. Slicing!
-    OBJModel getModel() override;
+    const OBJModel& getModel() override;
 };
 
 class World {
@@ -123,6 +164,12 @@ class World {
     virtual void setChunk(glm::ivec3 chunkCoordinate, Chunk chunk);
     // return the block at specific block coordinates
     char getBlock(glm::ivec3 blockCoordinate);
+    // set the block at specific block coordinates. returns false if its chunk doesn't exist
+    bool setBlock(glm::ivec3 blockCoordinate, uint8_t blockType);
+    // follow a ray from a position in blocks until it enters a solid block within reach.
+    // hit is that block and before is the block the ray passed through just before it,
+    // which shares the face the ray entered hit through
+    bool castRay(glm::vec3 from, glm::vec3 direction, float reach, glm::ivec3 &hit, glm::ivec3 &before);
     Chunk& getChunk(glm::ivec3 chunkCoordinate);
     bool hasChunk(glm::ivec3 chunkCoordinate);
     bool hasBlock(glm::ivec3 blockCoordinate);
@@ -158,25 +205,54 @@ class God {
 };
 
 class EntityGod: public God {
+  private:
+    // the scene model each entity model was uploaded as
+    std::unordered_map<const OBJModel*, uint32_t> sceneModels;
   public:
     EntityGod(World &world);
     void update() override;
+    // draw an instance of every entity in the scene's next frame, uploading the model of each
+    // kind the first time it is seen. entities around the eye, given in blocks, are left out,
+    // as the camera would only see them from inside. call from the drawing thread with the world locked
+    void drawEntities(Scene &scene, glm::vec3 eye);
     bool seesEntity(std::string name);
     void createEntity(Entity entity);
     void removeEntity(std::string name);
     Entity& getEntity(std::string name);
 };
 
+class ChunkGenerator;
+
 class TerrainGod: public God {
   private:
+    ChunkGenerator &generator;
     void generateChunk(glm::ivec3 chunkCoordinate, std::unordered_map<glm::ivec3, glm::vec3> &grid);
   public:
-    TerrainGod(World &world);
+    TerrainGod(World &world, ChunkGenerator &generator);
     void generateSpawn();
     void update() override;
 };
 
-class ChunkPerlinNoiseCache3D {
+// the algorithms noise can be sampled with
+enum NoiseEngine {
+  // classic gradient noise over a per-chunk cache of lattice vectors
+  NOISE_PERLIN,
+  // simplex noise with hashed gradients: 4 corners per sample and nothing cached per chunk
+  NOISE_SIMPLEX
+};
+
+// a source of noise values for the blocks of a chunk
+class ChunkNoiseSampler {
+  public:
+    virtual ~ChunkNoiseSampler() {}
+    virtual float sample(glm::ivec3 blockCoordinate) = 0;
+    // sample CHUNK_SIZE consecutive blocks along the x axis
+    virtual void sampleRow(glm::ivec3 firstBlock, float* values);
+    // conservative range of every value sample() can return within the chunk
+    virtual void bounds(float &lo, float &hi) const = 0;
+};
+
+class ChunkPerlinNoiseCache3D: public ChunkNoiseSampler {
   private:
     int seed;
     float scale;
@@ -189,6 +265,7 @@ class ChunkPerlinNoiseCache3D {
     int gridToIndex(glm::ivec3 gridCoordinate) const;
     glm::vec3 pseudoRandomVector(glm::ivec3 vectorGridCoordinate) const;
     float interpolate(float x, float y, float weight) const;
+    void boxBounds(glm::ivec3 cellOrigin, glm::vec3 boxLo, glm::vec3 boxHi, float &lo, float &hi) const;
   public:
   // TODO: make these fields private again
     glm::ivec3 corner1;
@@ -196,7 +273,27 @@ class ChunkPerlinNoiseCache3D {
     glm::vec3* grid;
     ChunkPerlinNoiseCache3D(float noiseScale, int worldSeed, glm::ivec3 chunkCoordinates);
     ~ChunkPerlinNoiseCache3D();
-    float sample(glm::ivec3 blockCoordinate);
+    float sample(glm::ivec3 blockCoordinate) override;
+    // derived from the lattice vectors alone
+    void bounds(float &lo, float &hi) const override;
+};
+
+// simplex noise doesn't depend on the chunk, so one sampler serves every chunk of a world
+class SimplexNoise3D: public ChunkNoiseSampler {
+  private:
+    float scale;
+    // a seeded shuffle of 0-255, repeated so lookups never need to wrap
+    uint8_t permutation[512];
+    // the hashed gradient index of a lattice point
+    int gradientIndex(int i, int j, int k) const;
+    // the noise at a point in grid space
+    float noise(float x, float y, float z) const;
+  public:
+    SimplexNoise3D(float noiseScale, int worldSeed);
+    float sample(glm::ivec3 blockCoordinate) override;
+    // a branch-free version of sample() over a row, which the compiler can vectorize
+    void sampleRow(glm::ivec3 firstBlock, float* values) override;
+    void bounds(float &lo, float &hi) const override;
 };
 
 // class ChunkPerlinNoiseCache2D {
@@ -241,44 +338,329 @@ class ChunkPerlinNoiseCache3D {
 // float ChunkPerlinNoiseCache2D::interpolate(float x, float y, float weight) const;
 // float ChunkPerlinNoiseCache2D::sample(glm::ivec2 blockCoordinate);
 
+// the scale, weight and algorithm of one octave of noise
 struct NoiseProfile {
+  float scale;
   float magnitude;
-  ChunkPerlinNoiseCache3D &sampler;
+  NoiseEngine engine = NOISE_PERLIN;
 };
 
+// generators decide the blocks of every chunk the terrain god creates
 class ChunkGenerator {
+  public:
+    virtual ~ChunkGenerator() {}
+    virtual Chunk generateChunk(glm::ivec3 chunkCoordinate) = 0;
+    // whether the spawn needs a platform built to stand on
+    virtual bool needsSpawnPlatform();
+};
+
+// the default world: octaves of 3D perlin noise carved around the terrain band
+class NoiseChunkGenerator: public ChunkGenerator {
   private:
-    glm::ivec3 chunkCoordinate;
     int seed;
-    std::vector<NoiseProfile*> noises;
-    float sampleCompoundNoise(glm::ivec3 localCoordinate);
+    std::vector<NoiseProfile> noises;
+    // samplers shared by every chunk, for the profiles whose engine needs no per-chunk cache
+    std::vector<ChunkNoiseSampler*> worldSamplers;
+    Chunk carveChunk(glm::ivec3 chunkCoordinate, std::vector<ChunkNoiseSampler*> &samplers);
+    // sum the octaves over CHUNK_SIZE consecutive blocks along the x axis
+    void sampleCompoundNoise(std::vector<ChunkNoiseSampler*> &samplers, glm::ivec3 firstBlock, float* values);
+    // the largest absolute value the compound noise can take anywhere
+    float amplitude();
+    // the noise value below which a block at an altitude is air
+    static float airThreshold(int y);
+    static uint8_t classifyBlock(float noiseValue, int y);
+    // whether every block in the chunk is air (or solid stone), whatever the noise does
+    static bool provablyAir(glm::ivec3 chunkCoordinate, float noiseHi);
+    static bool provablySolid(glm::ivec3 chunkCoordinate, float noiseLo);
   public:
-    ChunkGenerator(glm::ivec3 chunkCoordinate, int worldSeed, std::vector<NoiseProfile*> noiseProfiles);
-    Chunk generateChunk();
+    NoiseChunkGenerator(int worldSeed, std::vector<NoiseProfile> noiseProfiles);
+    ~NoiseChunkGenerator();
+    Chunk generateChunk(glm::ivec3 chunkCoordinate) override;
+    bool needsSpawnPlatform() override;
 };
 
-class RenderGod: public God {
+// grass over a few layers of dirt over stone, with the surface just below y = 0
+class SuperflatChunkGenerator: public ChunkGenerator {
+  public:
+    Chunk generateChunk(glm::ivec3 chunkCoordinate) override;
+};
+
+// alternating stone and air below y = 0, so every solid block shows all six faces
+class CheckerboardChunkGenerator: public ChunkGenerator {
+  public:
+    Chunk generateChunk(glm::ivec3 chunkCoordinate) override;
+};
+
+// every block of the world is the same type
+class UniformChunkGenerator: public ChunkGenerator {
   private:
-    Scene &scene;
-    std::unordered_map<glm::ivec3, RenderCache> cache;
+    uint8_t blockType;
   public:
-    RenderGod(World &world, Scene &scene);
-    // update the cache
-    void update() override;
-    void uploadCache(int max);
-    // allowance indicates how far chunks beyond the render radius
-    // are allowed to stay before they get culled from memory
-    void cullFarChunks(int allowance, int max);
-    void updateSun();
+    UniformChunkGenerator(uint8_t blockType);
+    Chunk generateChunk(glm::ivec3 chunkCoordinate) override;
 };
 
+// create the generator registered under a name, or nullptr if there is none
+ChunkGenerator* createChunkGenerator(std::string name, int worldSeed);
+
+// the names of all registered generators
+std::vector<std::string> chunkGeneratorNames();
+
 struct RenderBlockFace {
   glm::ivec3 blockCoordinate;
   glm::ivec3 facing;
   uint8_t blockType;
+  // how many blocks a merged face spans along each of the facing's other axes
+  glm::ivec2 size = {1, 1};
+};
+
+// the exposed faces of a chunk by direction in ORTHO_DIRS, then depth along the facing axis,
+// then row, with one bit per column. for x faces the rows run along z and the columns along y,
+// for y faces along z and x, and for z faces along y and x
+typedef uint16_t ChunkFaceMasks[6][CHUNK_SIZE][CHUNK_SIZE];
+
+// a chunk's exposed faces and their merged quads, kept by slice so that a block edit only
+// has to revisit the faces around that block and merge the slices they lie in
+class ChunkFaceTable {
+  private:
+    ChunkFaceMasks masks;
+    // the vertices of the merged quads by render pass, then direction in ORTHO_DIRS, then
+    // depth along the facing axis
+    std::vector<ChunkVertex> slices[RENDER_PASSES][6][CHUNK_SIZE];
+    // which slices changed since the mesh was last written
+    bool dirty[6][CHUNK_SIZE];
+  public:
+    // find every exposed face of a chunk. neighbors are as in Chunk::calculateChunkMesh
+    void build(Chunk &chunk, Chunk* neighbors[6]);
+    // take faces found elsewhere. every slice merges again on the next writeMesh
+    void build(const ChunkFaceMasks &faces);
+    const ChunkFaceMasks& getMasks();
+    // refresh the faces of a block after it or a block beside it changed
+    void updateBlock(Chunk &chunk, Chunk* neighbors[6], glm::ivec3 localBlockCoordinate);
+    // merge the changed slices and write out the whole mesh, in pass order then slice order.
+    // returns the first vertex that may differ from the mesh written before
+    size_t writeMesh(Chunk &chunk, glm::ivec3 chunkCoordinate, RenderCache &mesh);
 };
 
-// TODO: remove
-void addFaceVertices(OBJBuilder* builder, RenderBlockFace face);
+// RenderGod meshes chunks beyond each of these distances in chunks at the next coarser level
+// of detail, where level n fills each cube 2^n blocks wide with a single block type
+const int LOD_LEVELS = 5;
+const float LOD_DISTANCES[LOD_LEVELS - 1] = {2, 4, 6, 9};
+// how many chunks past the edge of its band a chunk must be before it switches level,
+// so that chunks along a boundary don't remesh back and forth as the player moves
+const float LOD_HYSTERESIS = 0.75f;
+
+// the level of detail whose band holds a chunk this many chunks from the player, before
+// RenderGod applies LOD_HYSTERESIS
+inline int levelForDistance(float distance) {
+  int level = 0;
+  while (level < LOD_LEVELS - 1 && distance > LOD_DISTANCES[level]) {
+    level += 1;
+  }
+  return level;
+}
+
+// a finished mesh on its way to the drawing thread
+struct MeshResult {
+  glm::ivec3 chunkCoordinate;
+  int level;
+  unsigned version;
+  RenderCache mesh;
+  // the faces behind a full resolution mesh, kept for patching it after block edits
+  ChunkFaceMasks faces;
+  // found from the full resolution blocks at every level of detail
+  ChunkConnections connections;
+  // when its job was queued
+  std::chrono::steady_clock::time_point queued;
+  MeshResult* next;
+};
+
+// finds the chunks an eye could see into through the faces each chunk connects, going by
+// Tommaso Checchi's "Minecraft's visibility culling"
+class ChunkPathSearch {
+  private:
+    // a chunk the search reached by its cell, through which face, having moved along which
+    // directions of ORTHO_DIRS as bits
+    struct PathStep {
+      int cell;
+      int face;
+      uint8_t directions;
+    };
+    // the chunks in a cube around the center, one cell each, kept between searches so
+    // their buffers get reused
+    glm::ivec3 gridCorner;
+    int gridSide = 0;
+    std::vector<ChunkConnections> gridConnections;
+    // the faces each chunk was entered through, as bits, with OUT_OF_REACH set on the cells
+    // too far from the center to search
+    std::vector<uint8_t> enteredFaces;
+    static const uint8_t OUT_OF_REACH = 0x80;
+    std::vector<PathStep> steps;
+    // whether the eye was near enough to the center to search from at all
+    bool searched = false;
+    // the cell of a chunk, or -1 outside the cube
+    int cell(glm::ivec3 chunkCoordinate) const;
+  public:
+    // search from the chunk the eye is in, staying within maxDistance chunks of center.
+    // chunks missing from connections may well be open, so paths go on through them. an eye
+    // farther out than that hides nothing
+    void search(const std::unordered_map<glm::ivec3, ChunkConnections> &connections, glm::ivec3 eyeChunk, glm::ivec3 center, float maxDistance);
+    // whether the last search reached a chunk
+    bool reached(glm::ivec3 chunkCoordinate) const;
+};
+
+// append the corners of a chunk's solid faces that face the eye's chunk, four to a quad in
+// world space, for the scene to draw as occluders
+void appendOccluders(glm::ivec3 chunkCoordinate, ChunkConnections connections, glm::ivec3 eyeChunk, std::vector<glm::vec3> &occluders);
+
+// how many spare jobs and results MeshWorkers keeps around for reuse
+const int MESH_POOL_SIZE = 256;
+
+// how many bytes of meshes RenderGod uploads each frame, past the first mesh, which always
+// goes. each mesh counts UPLOAD_MESH_OVERHEAD bytes on top of its vertices and indices for
+// the buffer calls around it, so a run of empty chunks doesn't go all at once
+const size_t UPLOAD_BUDGET = 256 * 1024;
+const size_t UPLOAD_MESH_OVERHEAD = 1024;
+
+// how the last upload went: the meshes still waiting to be meshed and to be uploaded, what
+// was uploaded, and how long after being queued for meshing it went up, in milliseconds
+struct UploadStats {
+  size_t meshing = 0;
+  size_t waiting = 0;
+  size_t uploaded = 0;
+  size_t bytes = 0;
+  float averageLatency = 0;
+  float maxLatency = 0;
+};
+
+// a copy of a chunk and the neighbors it culls against, so it can be meshed without the world lock
+struct MeshJob {
+  glm::ivec3 chunkCoordinate;
+  int level;
+  // counts up with every job, so a mesh that finishes after a newer one of its chunk can be dropped
+  unsigned version;
+  Chunk chunk;
+  // in the order of ORTHO_DIRS, only meaningful where their bit in found is set
+  Chunk neighbors[6];
+  uint8_t found;
+  // where the mesh goes, handed along by the worker once it is done
+  MeshResult* result;
+  std::chrono::steady_clock::time_point queued;
+  MeshJob* next;
+};
+
+// meshes chunks on a pool of threads. finished meshes come back through a lock-free queue,
+// so the thread taking them never waits on the meshers
+class MeshWorkers {
+  private:
+    std::vector<std::thread> threads;
+    std::mutex jobsMutex;
+    std::condition_variable jobsReady;
+    // waiting jobs from nextJob on
+    std::vector<MeshJob*> jobs;
+    size_t nextJob = 0;
+    bool stopping = false;
+    MPSCQueue<MeshResult> results;
+    // finished jobs and uploaded results, kept with their buffers so that remeshing doesn't
+    // allocate. the thread submitting jobs takes them back out
+    MPSCQueue<MeshJob> spareJobs;
+    MPSCQueue<MeshResult> spareResults;
+    std::atomic<int> spareJobCount = {0};
+    std::atomic<int> spareResultCount = {0};
+    // jobs handed out by newJob whose results haven't been queued yet
+    std::atomic<int> unfinishedJobs = {0};
+    void work();
+  public:
+    MeshWorkers(int count);
+    ~MeshWorkers();
+    // a job to fill in and submit, reusing an old one where possible.
+    // only call from the thread that submits
+    MeshJob* newJob();
+    // mesh chunks, in the order submitted
+    void submit(std::vector<MeshJob*> &batch);
+    // the next finished mesh, or nullptr if none are ready. hand it back to recycle once done
+    // with it. only call from one thread
+    MeshResult* nextResult();
+    void recycle(MeshResult* result);
+    // how many submitted jobs no worker has started on yet
+    size_t waitingJobs();
+    // whether every job handed out so far has its result queued. checked before taking results,
+    // once it is true nextResult will hand back every mesh still on its way
+    bool finished();
+    // mesh a job on the calling thread
+    static void mesh(MeshJob &job, MeshResult &result);
+};
+
+class RenderGod: public God {
+  private:
+    Scene &scene;
+    MeshWorkers workers;
+    // how each chunk's latest mesh was built
+    struct MeshState {
+      int level;
+      // the neighbors it was culled against, as bits in the order of ORTHO_DIRS
+      uint8_t neighbors;
+      // the version of the job meshing it
+      unsigned version;
+    };
+    std::unordered_map<glm::ivec3, MeshState> meshStates;
+    unsigned meshVersion = 0;
+    // the version of the mesh on screen for each chunk. only the drawing thread touches these
+    std::unordered_map<glm::ivec3, unsigned> shownVersions;
+    // chunks culled since the workers were last finished. their shown versions keep dropping any
+    // mesh still on its way, and are only let go once nothing can be. only the drawing thread
+    // touches these
+    std::vector<glm::ivec3> culledChunks;
+    // the faces of the chunks shown at full resolution, kept for patching their meshes.
+    // only the drawing thread touches these
+    std::unordered_map<glm::ivec3, ChunkFaceTable> faceTables;
+    // the level of detail of each chunk in the render sphere this update
+    std::unordered_map<glm::ivec3, int> levels;
+    // kept between updates and edits so their buffers get reused
+    std::vector<MeshJob*> pendingJobs;
+    RenderCache patch;
+    // finished meshes waiting for their turn to upload, farthest from the origin first. only
+    // the drawing thread touches these
+    std::vector<MeshResult*> readyMeshes;
+    UploadStats uploadStats;
+    // the scene's mesh of each chunk uploaded. only the drawing thread touches these
+    std::unordered_map<glm::ivec3, MeshHandle> chunkMeshes;
+    // the connections of each chunk with a mesh. only the drawing thread touches these
+    std::unordered_map<glm::ivec3, ChunkConnections> connections;
+    // the chunk the camera was in when meshes were last hidden, and whether connections changed since
+    glm::ivec3 sealedFrom;
+    bool sealedDirty = true;
+    ChunkPathSearch pathSearch;
+    // the corners of the solid chunk faces turned toward the eye's chunk, four per face, given
+    // to the scene to hide what is behind them
+    std::vector<glm::vec3> occluders;
+    // the level of detail for a chunk's distance from the origin, kept at its current level
+    // while within LOD_HYSTERESIS of its band
+    int levelOfDetail(glm::ivec3 chunkCoordinate);
+    // the chunks bordering a chunk in the order of ORTHO_DIRS, with nullptr for those that
+    // don't exist yet or are at another level of detail. returns the mask of those found
+    uint8_t gatherNeighbors(glm::ivec3 chunkCoordinate, int level, Chunk* neighbors[6]);
+  public:
+    RenderGod(World &world, Scene &scene, int meshWorkers);
+    ~RenderGod();
+    // queue the chunks that need meshing
+    void update() override;
+    // upload meshes the workers finished, nearest the origin first, until byteBudget bytes
+    // have gone up. call from the drawing thread
+    void uploadCache(size_t byteBudget);
+    UploadStats getUploadStats();
+    // allowance indicates how far chunks beyond the render radius
+    // are allowed to stay before they get culled from memory.
+    // call from the drawing thread with the world locked
+    void cullFarChunks(int allowance, int max);
+    // patch the meshes around a block that was just set, in place where they are uploaded.
+    // call from the drawing thread with the world locked
+    void updateBlock(glm::ivec3 blockCoordinate);
+    // hide the meshes of chunks that no path through open chunk faces leads to from the eye,
+    // given in blocks, and give the scene the solid faces of the rest as occluders. only
+    // searches again once the eye changes chunk or connections change. call from the drawing thread
+    void hideSealedChunks(glm::vec3 eye);
+    void updateSun();
+};
 
 #endif
\ No newline at end of file
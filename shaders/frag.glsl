@@ -1,19 +1,11 @@
 #version 410 core
 
-struct PointLight{
+// the camera and lights every pass shares, which must match FrameUniforms in scene.hpp
+struct PointLight {
   vec3 lightColor;
-  vec3 lightPos;
   float ambientIntensity;
-
+  vec3 lightPos;
   float specularStrength;
-
-  float constant;
-  float linear;
-  float quadratic;
-
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
 };
 
 struct Sun {
@@ -22,18 +14,32 @@ struct Sun {
   // TODO: could add some specular/ambient field here too
 };
 
+const int lightCount = 1;
+const int sunCount = 1;
+
+layout(std140) uniform FrameUniforms {
+  mat4 u_ViewMatrix;
+  mat4 u_Projection; // We'll use a perspective projection
+  vec3 u_viewPosition;
+  PointLight u_pointLights[lightCount];
+  Sun u_suns[sunCount];
+};
+
 in vec3 v_vertexNormals;
 in vec3 v_position;
 in vec2 v_TextureCoordinate;
 
 in vec3 viewPosition;
 
-const int lightCount = 1;
-uniform PointLight u_pointLights[lightCount];
-
-const int sunCount = 1;
-uniform Sun u_suns[sunCount];
 uniform sampler2D u_DiffuseTexture;
+// whether the texture coordinate is the corner of an atlas tile to repeat once per block
+uniform bool u_TiledTexture;
+
+// must match BLOCK_SCALE and the 32x32 tile layout of the block atlas
+const float blockScale = 0.5;
+const float tileSize = 0.03125;
+// the opacity of blocks drawn in the translucent pass
+const float translucentAlpha = 0.6;
 
 out vec4 color;
 
@@ -41,6 +47,14 @@ out vec4 color;
 //int specularFalloff = 32;
 vec3 normal = normalize(v_vertexNormals);
 
+// the position within the block tile, laid out along the same face axes the mesher uses
+vec2 tiledTextureCoordinate() {
+  vec3 block = v_position / blockScale + 0.5;
+  vec3 facing = abs(normal);
+  vec2 local = facing.x > 0.5 ? block.yz : (facing.y > 0.5 ? block.zx : block.xy);
+  return v_TextureCoordinate + fract(local) * tileSize;
+}
+
 vec3 calculateAmbient(PointLight light) {
   return light.ambientIntensity * light.lightColor;
 }
@@ -63,7 +77,8 @@ vec3 calculateSpecular(PointLight light) {
 // Entry point of program
 void main()
 {
-  vec3 diffuseColor = texture(u_DiffuseTexture, v_TextureCoordinate).rgb;
+  vec2 textureCoordinate = u_TiledTexture ? tiledTextureCoordinate() : v_TextureCoordinate;
+  vec3 diffuseColor = texture(u_DiffuseTexture, textureCoordinate).rgb;
   vec3 ambient = vec3(0.0f, 0.0f, 0.0f);
   vec3 diffuse = vec3(0.0f, 0.0f, 0.0f);
   vec3 specular = vec3(0.0f, 0.0f, 0.0f);
@@ -83,9 +98,16 @@ void main()
   }
   
   vec3 total = ambient + diffuse + specular;
+  // CUTOUT and TRANSLUCENT are defined by the program of each render pass
+#ifdef CUTOUT
   if (diffuseColor == vec3(1, 1, 1)) {
     discard;
   }
-  color = vec4(total.r * diffuseColor.r, total.g * diffuseColor.g, total.b * diffuseColor.b, 1.0f);
+#endif
+  float alpha = 1.0f;
+#ifdef TRANSLUCENT
+  alpha = translucentAlpha;
+#endif
+  color = vec4(total.r * diffuseColor.r, total.g * diffuseColor.g, total.b * diffuseColor.b, alpha);
 	//color = vec4(v_vertexNormals.r,v_vertexNormals.g, v_vertexNormals.b, 1.0f);
 }
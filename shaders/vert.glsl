@@ -6,13 +6,53 @@
 layout(location=0) in vec3 position;
 layout(location=1) in vec3 vertexNormals;
 layout(location=2) in vec2 textureCoordinate;
+// packed chunk vertices: (x, y, z, normal index) and (block type, corner, slot low byte, slot high byte)
+layout(location=3) in uvec4 chunkPosition;
+layout(location=4) in uvec4 chunkFace;
+// the model matrix of each instance, when drawing instances of a model
+layout(location=5) in mat4 instanceMatrix;
 
 // Uniform variables
 uniform mat4 u_ModelMatrix;
-uniform mat4 u_ViewMatrix;
-uniform mat4 u_Projection; // We'll use a perspective projection
 
-uniform vec3 u_viewPosition;
+// the camera and lights every pass shares, which must match FrameUniforms in scene.hpp
+struct PointLight {
+  vec3 lightColor;
+  float ambientIntensity;
+  vec3 lightPos;
+  float specularStrength;
+};
+
+struct Sun {
+  vec3 color;
+  vec3 direction;
+  // TODO: could add some specular/ambient field here too
+};
+
+const int lightCount = 1;
+const int sunCount = 1;
+
+layout(std140) uniform FrameUniforms {
+  mat4 u_ViewMatrix;
+  mat4 u_Projection; // We'll use a perspective projection
+  vec3 u_viewPosition;
+  PointLight u_pointLights[lightCount];
+  Sun u_suns[sunCount];
+};
+
+// whether to read the packed chunk attributes, whose positions are relative to the origin in
+// blocks of their slot in u_ChunkOrigins
+uniform bool u_PackedChunk;
+uniform samplerBuffer u_ChunkOrigins;
+// whether to place vertices by instanceMatrix instead of u_ModelMatrix
+uniform bool u_Instanced;
+
+// must match BLOCK_SCALE, ORTHO_DIRS and the 32x32 tile layout of the block atlas
+const float blockScale = 0.5;
+const float tileSize = 0.03125;
+const vec3 directions[6] = vec3[6](
+  vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)
+);
 
 // Pass vertex colors into the fragment shader
 out vec3 v_vertexNormals;
@@ -23,13 +63,27 @@ out vec3 viewPosition;
 
 void main()
 {
+  vec3 vertexPosition = position;
   v_vertexNormals= vertexNormals;
-  v_position = position;
   v_TextureCoordinate = textureCoordinate;
+  if (u_PackedChunk) {
+    // chunk positions are block corners, half a block off the block centers
+    vec3 chunkOrigin = texelFetch(u_ChunkOrigins, int(chunkFace.z | chunkFace.w << 8)).xyz;
+    vertexPosition = (chunkOrigin + vec3(chunkPosition.xyz) - 0.5) * blockScale;
+    v_vertexNormals = directions[chunkPosition.w];
+    v_TextureCoordinate = vec2(float(chunkFace.x - 1u) * tileSize, 0.0);
+  }
+  mat4 modelMatrix = u_ModelMatrix;
+  if (u_Instanced) {
+    modelMatrix = instanceMatrix;
+    v_vertexNormals = transpose(inverse(mat3(instanceMatrix))) * vertexNormals;
+  }
+  vec4 worldPosition = modelMatrix * vec4(vertexPosition, 1.0f);
+  v_position = worldPosition.xyz;
 
   viewPosition = u_viewPosition;
 
-  vec4 newPosition = u_Projection * u_ViewMatrix * u_ModelMatrix * vec4(position,1.0f);
+  vec4 newPosition = u_Projection * u_ViewMatrix * worldPosition;
                                                                     // Don't forget 'w'
 	gl_Position = vec4(newPosition.x, newPosition.y, newPosition.z, newPosition.w);
 }
@@ -0,0 +1,111 @@
+#include "frustum.hpp"
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+Frustum extractFrustum(const glm::mat4 &projectionView) {
+  // glm is column major, so row i of the matrix is element i of each column
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; i += 1) {
+    rows[i] = glm::vec4(projectionView[0][i], projectionView[1][i], projectionView[2][i], projectionView[3][i]);
+  }
+  // a point is inside when -w <= x, y, z <= w in clip space, which gives a plane per side:
+  // left, right, bottom, top, near, far
+  Frustum frustum;
+  for (int axis = 0; axis < 3; axis += 1) {
+    frustum.planes[axis * 2] = rows[3] + rows[axis];
+    frustum.planes[axis * 2 + 1] = rows[3] - rows[axis];
+  }
+  for (glm::vec4 &plane : frustum.planes) {
+    float length = glm::length(glm::vec3(plane));
+    if (length > 0) {
+      plane /= length;
+    }
+  }
+  return frustum;
+}
+
+// whether a box given by its center and half size reaches inside every plane
+static bool intersectsPlanes(const Frustum &frustum, glm::vec3 center, glm::vec3 extent) {
+  for (const glm::vec4 &plane : frustum.planes) {
+    // how far the box reaches toward the plane's inside from its center
+    float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+    float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+    if (distance + radius < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool intersectsFrustum(const Frustum &frustum, const AABB &box) {
+  return intersectsPlanes(frustum, (box.min + box.max) * 0.5f, (box.max - box.min) * 0.5f);
+}
+
+void AABBBatch::clear() {
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  extentX.clear();
+  extentY.clear();
+  extentZ.clear();
+}
+
+void AABBBatch::add(const AABB &box) {
+  glm::vec3 center = (box.min + box.max) * 0.5f;
+  glm::vec3 extent = (box.max - box.min) * 0.5f;
+  centerX.push_back(center.x);
+  centerY.push_back(center.y);
+  centerZ.push_back(center.z);
+  extentX.push_back(extent.x);
+  extentY.push_back(extent.y);
+  extentZ.push_back(extent.z);
+}
+
+size_t AABBBatch::size() const {
+  return centerX.size();
+}
+
+size_t AABBBatch::cull(const Frustum &frustum, std::vector<uint8_t> &visible) const {
+  size_t count = size();
+  visible.resize(count);
+  size_t inside = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  // the same sums as intersectsPlanes in the same order, for four boxes at a time
+  for (; i + 4 <= count; i += 4) {
+    __m128 cx = _mm_loadu_ps(&centerX[i]);
+    __m128 cy = _mm_loadu_ps(&centerY[i]);
+    __m128 cz = _mm_loadu_ps(&centerZ[i]);
+    __m128 ex = _mm_loadu_ps(&extentX[i]);
+    __m128 ey = _mm_loadu_ps(&extentY[i]);
+    __m128 ez = _mm_loadu_ps(&extentZ[i]);
+    __m128 outside = _mm_setzero_ps();
+    for (const glm::vec4 &plane : frustum.planes) {
+      __m128 radius = _mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(_mm_set1_ps(std::fabs(plane.x)), ex),
+        _mm_mul_ps(_mm_set1_ps(std::fabs(plane.y)), ey)),
+        _mm_mul_ps(_mm_set1_ps(std::fabs(plane.z)), ez));
+      __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+        _mm_mul_ps(_mm_set1_ps(plane.x), cx),
+        _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+        _mm_mul_ps(_mm_set1_ps(plane.z), cz)),
+        _mm_set1_ps(plane.w));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+    }
+    int outsideBits = _mm_movemask_ps(outside);
+    for (int k = 0; k < 4; k += 1) {
+      visible[i + k] = !(outsideBits >> k & 1);
+      inside += visible[i + k];
+    }
+  }
+#endif
+  for (; i < count; i += 1) {
+    glm::vec3 center = glm::vec3(centerX[i], centerY[i], centerZ[i]);
+    glm::vec3 extent = glm::vec3(extentX[i], extentY[i], extentZ[i]);
+    visible[i] = intersectsPlanes(frustum, center, extent);
+    inside += visible[i];
+  }
+  return inside;
+}
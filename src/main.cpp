@@ -15,6 +15,9 @@
 #include <fstream>
 #include <unordered_map>
 #include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 
 // Our libraries
 #include "Camera.hpp"
@@ -37,6 +40,8 @@ Camera gCamera;
 
 const int FRAMERATE = 120;
 const int FRAMETIME_MS = std::floor(1000.0 / FRAMERATE);
+// how many chunks away terrain is generated and drawn, coarser with distance
+const int RENDER_RADIUS = 12;
 
 /**
 * Initialization of the graphics application. Typically this will involve setting up a window
@@ -95,6 +100,34 @@ struct Game {
   int timeSprinting = 0;
 };
 
+// break the block the player is looking at, or place stone against it
+void editBlock(Game &game, bool breaking) {
+  game.world.divineIntervention.lock();
+  Entity &player = game.entityGod.getEntity("player");
+  glm::vec3 eye = player.getPosition() + glm::vec3(POSY) * player.getHitbox().dimensions.y * 0.35333f;
+  glm::ivec3 hit, before;
+  if (game.world.castRay(eye, gCamera.getDirection(), 8.0f, hit, before)) {
+    glm::ivec3 target = breaking ? hit : before;
+    if (game.world.setBlock(target, breaking ? BLOCKTYPE_AIR : BLOCKTYPE_STONE)) {
+      game.renderGod.updateBlock(target);
+    }
+  }
+  game.world.divineIntervention.unlock();
+}
+
+// show what the last frame drew and how far behind the chunk meshes are in the window title,
+// so the culling and uploads can be watched while playing
+void showStats(Game &game) {
+  FrameStats frame = game.scene.getFrameStats();
+  UploadStats upload = game.renderGod.getUploadStats();
+  std::string title = "Tesselation | " + std::to_string(frame.drawn) + " drawn, "
+    + std::to_string(frame.culled) + " culled, " + std::to_string(frame.occluded) + " occluded, "
+    + std::to_string(frame.hidden) + " hidden, " + std::to_string(frame.stateChanges) + " state changes | "
+    + std::to_string(upload.meshing) + " meshing, " + std::to_string(upload.waiting) + " waiting, "
+    + std::to_string(int(upload.averageLatency)) + " ms latency (" + std::to_string(int(upload.maxLatency)) + " max)";
+  SDL_SetWindowTitle(gGraphicsApplicationWindow, title.c_str());
+}
+
 /**
 * Function called in the Main application loop to handle user input
 *
@@ -125,6 +158,12 @@ void Input(Game &game) {
       mouseX+=e.motion.xrel;
       mouseY+=e.motion.yrel;
       gCamera.MouseLook(mouseX,mouseY);
+    }
+    if(e.type==SDL_MOUSEBUTTONDOWN) {
+      // left click breaks blocks and right click places them
+      if (e.button.button == SDL_BUTTON_LEFT || e.button.button == SDL_BUTTON_RIGHT) {
+        editBlock(game, e.button.button == SDL_BUTTON_LEFT);
+      }
     }
 	}
 
@@ -206,6 +245,8 @@ void MainLoop(Game &game){
   int uploadCacheTick = 1;
   // update generation once every 2 seconds
   int generationTick = FRAMERATE * 2;
+  // show the stats once a second
+  int statsTick = FRAMERATE;
 	// While application is running
   std::thread renderThread(&updateRenderingForever, &game.renderGod, &gQuit);
   std::thread terrainGenerationThread(&generateTerrainForever, &game.terrainGod, &gQuit);
@@ -221,6 +262,8 @@ void MainLoop(Game &game){
     glm::vec3 cameraOffset = glm::vec3(POSY) * player.getHitbox().dimensions.y * 0.35333f;
     glm::vec3 pos = (player.getPosition() + cameraOffset) * BLOCK_SCALE;
     gCamera.SetCameraEyePosition(pos.x, pos.y, pos.z);
+    game.renderGod.hideSealedChunks(pos / BLOCK_SCALE);
+    game.entityGod.drawEntities(game.scene, pos / BLOCK_SCALE);
     game.renderGod.updateSun();
     if (tick % minuteTick == 0) {
       game.world.time += 1;
@@ -232,7 +275,7 @@ void MainLoop(Game &game){
       game.entityGod.update();
     }
     if (tick % uploadCacheTick == 0) {
-      game.renderGod.uploadCache(1);
+      game.renderGod.uploadCache(UPLOAD_BUDGET);
     }
     if (tick % cullFarChunksTick == 0) {
       // wrap up rendering stuff
@@ -251,6 +294,9 @@ void MainLoop(Game &game){
     // }
 		// Draw Calls in OpenGL
 		game.scene.draw();
+    if (tick % statsTick == 0) {
+      showStats(game);
+    }
 		//Update screen of our specified window
 		SDL_GL_SwapWindow(gGraphicsApplicationWindow);
     std::this_thread::sleep_until(frameEnd);
@@ -286,13 +332,39 @@ void CleanUp(){
 * @return program status
 */
 int main(int argc, char* args[]) {
+  // the terrain generator and seed can be chosen for reproducible worlds:
+  //   ./project [generator] [seed]
+  std::string generatorName = argc > 1 ? args[1] : "noise";
+  int seed = time(NULL);
+  if (argc > 2) {
+    char* end;
+    errno = 0;
+    long parsed = strtol(args[2], &end, 10);
+    if (end == args[2] || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) {
+      std::cout << "Bad seed " << args[2] << ", usage: " << args[0] << " [generator] [seed]" << std::endl;
+      exit(1);
+    }
+    seed = int(parsed);
+  }
+  ChunkGenerator* chunkGenerator = createChunkGenerator(generatorName, seed);
+  if (chunkGenerator == nullptr) {
+    std::cout << "Unknown generator " << generatorName << ", choose one of:";
+    for (std::string name : chunkGeneratorNames()) {
+      std::cout << " " << name;
+    }
+    std::cout << std::endl;
+    exit(1);
+  }
+
 	// 1. Setup the graphics program
 	InitializeProgram();
 
   Scene scene(gScreenWidth, gScreenHeight, gCamera);
-  World world(time(NULL));
-  RenderGod renderer(world, scene);
-  TerrainGod generator(world);
+  World world(seed);
+  // leave a core each for the drawing and generation threads
+  int meshWorkers = std::max(1, int(std::thread::hardware_concurrency()) - 2);
+  RenderGod renderer(world, scene, meshWorkers);
+  TerrainGod generator(world, *chunkGenerator);
   EntityGod entityManager(world);
   Game game = {world, scene, generator, entityManager, renderer};
   //generator.generateSpawn();
@@ -306,15 +378,19 @@ int main(int argc, char* args[]) {
   generator.setOrigin({0, 0, 0});
   generator.setRadius(2);
   generator.update();
+  // the rest of the view fills in from the generation thread
+  generator.setRadius(RENDER_RADIUS);
 
   renderer.setOrigin({0, 0, 0});
-  renderer.setRadius(4);
+  renderer.setRadius(RENDER_RADIUS);
   renderer.update();
+  scene.setViewDistance(RENDER_RADIUS * CHUNK_SIZE * BLOCK_SCALE);
 	// 4. Call the main application loop
 	MainLoop(game);
 
 	// 5. Call the cleanup function when our program terminates
 	CleanUp();
+  delete chunkGenerator;
 
 	return 0;
 }
@@ -169,12 +169,12 @@ OBJModel UNIT_CUBE() {
   std::vector<glm::vec3> vertexNormals{{1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1}, {-1, 1, 1}, {-1, 1, -1}, {-1, -1, 1}, {-1, -1, -1}};
   
   std::vector<Face> faces{
-      {{{0, 0}, {1, 1}, {3, 3}}}, {{{0, 0}, {3, 3}, {2, 2}}},
-      {{{0, 0}, {4, 4}, {1, 1}}}, {{{4, 4}, {5, 5}, {1, 1}}},
-      {{{2, 2}, {3, 3}, {6, 6}}}, {{{6, 6}, {3, 3}, {7, 7}}},
-      {{{6, 6}, {5, 5}, {4, 4}}}, {{{6, 6}, {7, 7}, {5, 5}}},
-      {{{6, 6}, {0, 0}, {2, 2}}}, {{{6, 6}, {4, 4}, {0, 0}}},
-      {{{7, 7}, {3, 3}, {1, 1}}}, {{{7, 7}, {1, 1}, {5, 5}}}
+      {{{0, 0}, {3, 3}, {1, 1}}}, {{{0, 0}, {2, 2}, {3, 3}}},
+      {{{0, 0}, {1, 1}, {4, 4}}}, {{{4, 4}, {1, 1}, {5, 5}}},
+      {{{2, 2}, {6, 6}, {3, 3}}}, {{{6, 6}, {7, 7}, {3, 3}}},
+      {{{6, 6}, {4, 4}, {5, 5}}}, {{{6, 6}, {5, 5}, {7, 7}}},
+      {{{6, 6}, {2, 2}, {0, 0}}}, {{{6, 6}, {0, 0}, {4, 4}}},
+      {{{7, 7}, {1, 1}, {3, 3}}}, {{{7, 7}, {5, 5}, {1, 1}}}
     };
   return {vertices, vertexNormals, faces};
 }
@@ -0,0 +1,204 @@
+#include "occlusion.hpp"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) : width(width), height(height) {
+  stride = (width + 3) & ~3;
+  depths.resize(stride * height, FLT_MAX);
+}
+
+void OcclusionBuffer::clear(const glm::mat4 &projectionView) {
+  this->projectionView = projectionView;
+  std::fill(depths.begin(), depths.end(), FLT_MAX);
+}
+
+void OcclusionBuffer::rasterizeQuad(const glm::vec3 corners[4]) {
+  glm::vec3 screen[4];
+  for (int i = 0; i < 4; i += 1) {
+    glm::vec4 clip = projectionView * glm::vec4(corners[i], 1);
+    if (clip.z < -clip.w || clip.w <= 0) {
+      return;
+    }
+    screen[i] = glm::vec3(
+      (clip.x / clip.w * 0.5f + 0.5f) * width,
+      (clip.y / clip.w * 0.5f + 0.5f) * height,
+      clip.z / clip.w);
+  }
+  rasterizeConvex(screen);
+}
+
+void OcclusionBuffer::rasterizeConvex(glm::vec3 corners[4]) {
+  // wind every quad the same way, so the inside is where all four edges are positive
+  float area = 0;
+  for (int i = 0; i < 4; i += 1) {
+    glm::vec3 a = corners[i], b = corners[(i + 1) % 4];
+    area += a.x * b.y - a.y * b.x;
+  }
+  if (area == 0) {
+    return;
+  }
+  if (area < 0) {
+    std::swap(corners[1], corners[3]);
+  }
+  float lowX = corners[0].x, highX = corners[0].x, lowY = corners[0].y, highY = corners[0].y;
+  for (int i = 1; i < 4; i += 1) {
+    lowX = std::min(lowX, corners[i].x);
+    highX = std::max(highX, corners[i].x);
+    lowY = std::min(lowY, corners[i].y);
+    highY = std::max(highY, corners[i].y);
+  }
+  int minX = std::max(0, (int)std::floor(lowX));
+  int maxX = std::min(width - 1, (int)std::floor(highX));
+  int minY = std::max(0, (int)std::floor(lowY));
+  int maxY = std::min(height - 1, (int)std::floor(highY));
+  if (minX > maxX || minY > maxY) {
+    return;
+  }
+  // depth is linear in screen space over the flat quad. take its slope from whichever half
+  // of it is larger, which is the better conditioned
+  glm::vec3 a = corners[0], b = corners[1], c = corners[2];
+  float half = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+  float otherHalf = (c.x - a.x) * (corners[3].y - a.y) - (c.y - a.y) * (corners[3].x - a.x);
+  if (std::fabs(otherHalf) > std::fabs(half)) {
+    b = c;
+    c = corners[3];
+    half = otherHalf;
+  }
+  float depthX = (a.z * (b.y - c.y) + b.z * (c.y - a.y) + c.z * (a.y - b.y)) / half;
+  float depthY = (a.z * (c.x - b.x) + b.z * (a.x - c.x) + c.z * (b.x - a.x)) / half;
+  // start each row on a multiple of 4 pixels. the few pixels either side of the quad's
+  // bounds this covers are outside it, or in the padding at the end of a row
+  int startX = minX & ~3;
+  float x = startX + 0.5f;
+  float y = minY + 0.5f;
+  // each edge function is how far a point is inside an edge, scaled by the edge's length, and
+  // changes by a fixed step per pixel across and up. only pixels the quad covers whole are
+  // filled, and with the farthest depth over them, so nothing is hidden by an occluder that
+  // doesn't reach all the way across it: the edge functions are taken at each pixel's worst
+  // corner rather than its centre, half a step each way, and the depth at its farthest
+  float stepX[4], stepY[4], edge[4];
+  for (int i = 0; i < 4; i += 1) {
+    glm::vec3 from = corners[i], to = corners[(i + 1) % 4];
+    stepX[i] = from.y - to.y;
+    stepY[i] = to.x - from.x;
+    edge[i] = stepY[i] * (y - from.y) + stepX[i] * (x - from.x) - 0.5f * (std::fabs(stepX[i]) + std::fabs(stepY[i]));
+  }
+  float depth = a.z + depthX * (x - a.x) + depthY * (y - a.y) + 0.5f * (std::fabs(depthX) + std::fabs(depthY));
+#ifdef __SSE2__
+  const __m128 lanes = _mm_setr_ps(0, 1, 2, 3);
+  const __m128 zero = _mm_setzero_ps();
+  __m128 laneX[4], groupX[4];
+  for (int i = 0; i < 4; i += 1) {
+    laneX[i] = _mm_mul_ps(lanes, _mm_set1_ps(stepX[i]));
+    groupX[i] = _mm_set1_ps(stepX[i] * 4);
+  }
+  __m128 laneDepth = _mm_mul_ps(lanes, _mm_set1_ps(depthX));
+  __m128 groupDepth = _mm_set1_ps(depthX * 4);
+  for (int row = minY; row <= maxY; row += 1) {
+    __m128 e0 = _mm_add_ps(_mm_set1_ps(edge[0]), laneX[0]);
+    __m128 e1 = _mm_add_ps(_mm_set1_ps(edge[1]), laneX[1]);
+    __m128 e2 = _mm_add_ps(_mm_set1_ps(edge[2]), laneX[2]);
+    __m128 e3 = _mm_add_ps(_mm_set1_ps(edge[3]), laneX[3]);
+    __m128 z = _mm_add_ps(_mm_set1_ps(depth), laneDepth);
+    float* pixels = &depths[row * stride];
+    for (int column = startX; column <= maxX; column += 4) {
+      __m128 inside = _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+        _mm_and_ps(_mm_cmpge_ps(e2, zero), _mm_cmpge_ps(e3, zero)));
+      if (_mm_movemask_ps(inside) != 0) {
+        __m128 old = _mm_load_ps(&pixels[column]);
+        __m128 nearer = _mm_min_ps(old, z);
+        _mm_store_ps(&pixels[column], _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+      }
+      e0 = _mm_add_ps(e0, groupX[0]);
+      e1 = _mm_add_ps(e1, groupX[1]);
+      e2 = _mm_add_ps(e2, groupX[2]);
+      e3 = _mm_add_ps(e3, groupX[3]);
+      z = _mm_add_ps(z, groupDepth);
+    }
+    for (int i = 0; i < 4; i += 1) {
+      edge[i] += stepY[i];
+    }
+    depth += depthY;
+  }
+#else
+  for (int row = minY; row <= maxY; row += 1) {
+    float e0 = edge[0], e1 = edge[1], e2 = edge[2], e3 = edge[3], z = depth;
+    float* pixels = &depths[row * stride];
+    for (int column = startX; column <= maxX; column += 1) {
+      if (e0 >= 0 && e1 >= 0 && e2 >= 0 && e3 >= 0) {
+        pixels[column] = std::min(pixels[column], z);
+      }
+      e0 += stepX[0];
+      e1 += stepX[1];
+      e2 += stepX[2];
+      e3 += stepX[3];
+      z += depthX;
+    }
+    for (int i = 0; i < 4; i += 1) {
+      edge[i] += stepY[i];
+    }
+    depth += depthY;
+  }
+#endif
+}
+
+bool OcclusionBuffer::visible(const AABB &box) const {
+  glm::vec2 low = glm::vec2(FLT_MAX);
+  glm::vec2 high = glm::vec2(-FLT_MAX);
+  // the nearest point of a box is always one of its corners
+  float nearest = FLT_MAX;
+  for (int i = 0; i < 8; i += 1) {
+    glm::vec3 corner = glm::vec3(
+      i & 1 ? box.max.x : box.min.x,
+      i & 2 ? box.max.y : box.min.y,
+      i & 4 ? box.max.z : box.min.z);
+    glm::vec4 clip = projectionView * glm::vec4(corner, 1);
+    if (clip.z < -clip.w || clip.w <= 0) {
+      return true;
+    }
+    glm::vec2 screen = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * glm::vec2(width, height);
+    low = glm::min(low, screen);
+    high = glm::max(high, screen);
+    nearest = std::min(nearest, clip.z / clip.w);
+  }
+  int minX = std::max(0, (int)std::floor(low.x));
+  int maxX = std::min(width - 1, (int)std::floor(high.x));
+  int minY = std::max(0, (int)std::floor(low.y));
+  int maxY = std::min(height - 1, (int)std::floor(high.y));
+  // visible if any pixel it covers has nothing drawn in front of its nearest point
+  for (int row = minY; row <= maxY; row += 1) {
+    const float* pixels = &depths[row * stride];
+    int column = minX;
+#ifdef __SSE2__
+    __m128 boxDepth = _mm_set1_ps(nearest);
+    for (; column + 4 <= maxX + 1; column += 4) {
+      if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(&pixels[column]), boxDepth)) != 0) {
+        return true;
+      }
+    }
+#endif
+    for (; column <= maxX; column += 1) {
+      if (pixels[column] > nearest) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+int OcclusionBuffer::getWidth() const {
+  return width;
+}
+
+int OcclusionBuffer::getHeight() const {
+  return height;
+}
+
+float OcclusionBuffer::getDepth(int x, int y) const {
+  return depths[y * stride + x];
+}
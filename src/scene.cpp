@@ -92,19 +92,26 @@ GLuint CreateShaderProgram(const std::string& vertexShaderSource, const std::str
   return programObject;
 }
 
-GLuint CreateGraphicsPipeline() {
+GLuint CreateGraphicsPipeline(const std::string& defines) {
   std::string vertexShaderSource = LoadShaderAsString("./shaders/vert.glsl");
   std::string fragmentShaderSource = LoadShaderAsString("./shaders/frag.glsl");
+  // #version has to stay the first line
+  vertexShaderSource.insert(vertexShaderSource.find('\n') + 1, defines);
+  fragmentShaderSource.insert(fragmentShaderSource.find('\n') + 1, defines);
 
 	return CreateShaderProgram(vertexShaderSource,fragmentShaderSource);
 }
 
 // encode an OBJ into VBO data
-bool encodeOBJ(OBJModel model, std::vector<VBOVertex> &data, std::vector<GLuint> &indices) {
+bool encodeOBJ(const OBJModel &model, std::vector<VBOVertex> &data, std::vector<GLuint> &indices) {
   std::unordered_map<VBOVertex, int> processedVertices;
+  processedVertices.reserve(model.vertices.size());
 
-  for (Face face : model.faces) {
-    for (VertexDescriptor vd : face.vertexDescriptors) {
+  // the index of each of a face's vertices, before splitting it into triangles
+  std::vector<GLuint> corners;
+  for (const Face &face : model.faces) {
+    corners.clear();
+    for (const VertexDescriptor &vd : face.vertexDescriptors) {
       if (vd.vertex < 0 || vd.vertex >= model.vertices.size()) {
         return false;
       }
@@ -121,51 +128,404 @@ bool encodeOBJ(OBJModel model, std::vector<VBOVertex> &data, std::vector<GLuint>
         model.vertexNormals.at(vd.vertexNormal),
         tc
         );
-      int index;
-      if (processedVertices.find(v) == processedVertices.end()) {
-        // if not pre-existing
-        index = data.size();
+      // the index the vertex would get if it is new
+      auto inserted = processedVertices.emplace(v, data.size());
+      if (inserted.second) {
         data.push_back(v);
-        processedVertices[v] = index;
-      } else {
-        // if already exists
-        index = processedVertices.at(v);
       }
-      indices.push_back(index);
+      corners.push_back(inserted.first->second);
+    }
+    for (size_t i = 2; i < corners.size(); i += 1) {
+      indices.push_back(corners[0]);
+      indices.push_back(corners[i - 1]);
+      indices.push_back(corners[i]);
     }
   }
   return true;
 }
 
-void Mesh::setVBOfromOBJ(OBJModel model) {
+// the cache optimizer's scoring, from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+const int SCORED_CACHE_SIZE = 32;
+
+float vertexCacheScore(int cachePosition, int remainingTriangles) {
+  if (remainingTriangles == 0) {
+    return -1;
+  }
+  float score = 0;
+  if (cachePosition < 0) {
+    // not in the cache
+  } else if (cachePosition < 3) {
+    // used by the last triangle, which gains little from being used again straight away
+    score = 0.75f;
+  } else {
+    score = std::pow(1.0f - (cachePosition - 3) / float(SCORED_CACHE_SIZE - 3), 1.5f);
+  }
+  // vertices with few triangles left are worth finishing, so they can leave the cache
+  return score + 2.0f / std::sqrt((float)remainingTriangles);
+}
+
+void optimizeVertexCache(std::vector<GLuint> &indices, size_t vertexCount) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+  // the triangles using each vertex. the first remaining[v] from triangleStart[v] are the
+  // ones not emitted yet
+  std::vector<int> remaining(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; i += 1) {
+    remaining[indices[i]] += 1;
+  }
+  std::vector<size_t> triangleStart(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v += 1) {
+    triangleStart[v + 1] = triangleStart[v] + remaining[v];
+  }
+  std::vector<int> vertexTriangles(triangleCount * 3);
+  std::vector<size_t> filled(triangleStart.begin(), triangleStart.end() - 1);
+  for (size_t i = 0; i < triangleCount * 3; i += 1) {
+    vertexTriangles[filled[indices[i]]++] = i / 3;
+  }
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t v = 0; v < vertexCount; v += 1) {
+    vertexScores[v] = vertexCacheScore(-1, remaining[v]);
+  }
+  std::vector<float> triangleScores(triangleCount);
+  for (size_t t = 0; t < triangleCount; t += 1) {
+    triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+  }
+  std::vector<bool> emitted(triangleCount, false);
+
+  std::vector<GLuint> result;
+  result.reserve(triangleCount * 3);
+  std::vector<GLuint> cache;
+  std::vector<GLuint> nextCache;
+  int best = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+  // where to look for a triangle to restart from once the cache has none left to offer
+  size_t nextUnemitted = 0;
+  while (result.size() < triangleCount * 3) {
+    if (best < 0) {
+      while (emitted[nextUnemitted]) {
+        nextUnemitted += 1;
+      }
+      best = nextUnemitted;
+    }
+    emitted[best] = true;
+    nextCache.clear();
+    for (int k = 0; k < 3; k += 1) {
+      GLuint v = indices[best * 3 + k];
+      result.push_back(v);
+      nextCache.push_back(v);
+      // take the triangle out of the vertex's remaining ones
+      int *triangles = &vertexTriangles[triangleStart[v]];
+      int last = remaining[v] - 1;
+      for (int i = 0; i <= last; i += 1) {
+        if (triangles[i] == best) {
+          std::swap(triangles[i], triangles[last]);
+          break;
+        }
+      }
+      remaining[v] = last;
+    }
+    for (GLuint v : cache) {
+      if (v != nextCache[0] && v != nextCache[1] && v != nextCache[2]) {
+        nextCache.push_back(v);
+      }
+    }
+    // rescore the vertices that moved, including the ones pushed out, then their triangles
+    for (size_t i = 0; i < nextCache.size(); i += 1) {
+      GLuint v = nextCache[i];
+      cachePosition[v] = i < SCORED_CACHE_SIZE ? i : -1;
+      vertexScores[v] = vertexCacheScore(cachePosition[v], remaining[v]);
+    }
+    best = -1;
+    float bestScore = 0;
+    for (GLuint v : nextCache) {
+      const int *triangles = &vertexTriangles[triangleStart[v]];
+      for (int i = 0; i < remaining[v]; i += 1) {
+        int t = triangles[i];
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > bestScore) {
+          best = t;
+          bestScore = triangleScores[t];
+        }
+      }
+    }
+    if (nextCache.size() > SCORED_CACHE_SIZE) {
+      nextCache.resize(SCORED_CACHE_SIZE);
+    }
+    std::swap(cache, nextCache);
+  }
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+// the FIFO cache overdraw clusters are cut against, about the size of a real one
+const unsigned int CLUSTER_CACHE_SIZE = 16;
+
+// how many of a triangle's vertices miss a simulated FIFO cache. a vertex stays cached
+// until CLUSTER_CACHE_SIZE others have been loaded after it
+int clusterCacheMisses(const GLuint *triangle, std::vector<unsigned int> &loadedAt, unsigned int &time) {
+  int misses = 0;
+  for (int k = 0; k < 3; k += 1) {
+    if (time - loadedAt[triangle[k]] >= CLUSTER_CACHE_SIZE) {
+      loadedAt[triangle[k]] = time;
+      time += 1;
+      misses += 1;
+    }
+  }
+  return misses;
+}
+
+void optimizeOverdraw(std::vector<GLuint> &indices, const std::vector<VBOVertex> &data, float threshold) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+  // every vertex starts out long gone from the cache
+  std::vector<unsigned int> loadedAt(data.size(), 0);
+  unsigned int time = CLUSTER_CACHE_SIZE + 1;
+  // the cache is cold wherever a triangle misses all three vertices, so cutting there is free
+  std::vector<size_t> hardStarts;
+  for (size_t t = 0; t < triangleCount; t += 1) {
+    if (clusterCacheMisses(&indices[t * 3], loadedAt, time) == 3) {
+      hardStarts.push_back(t);
+    }
+  }
+  hardStarts.push_back(triangleCount);
+
+  // cut the hard clusters further wherever the triangles so far already reuse the cache about
+  // as well as the whole cluster does
+  std::vector<size_t> starts;
+  for (size_t c = 0; c + 1 < hardStarts.size(); c += 1) {
+    size_t start = hardStarts[c];
+    size_t end = hardStarts[c + 1];
+    time += CLUSTER_CACHE_SIZE + 1;
+    int clusterMisses = 0;
+    for (size_t t = start; t < end; t += 1) {
+      clusterMisses += clusterCacheMisses(&indices[t * 3], loadedAt, time);
+    }
+    float allowedRatio = threshold * clusterMisses / (end - start);
+    time += CLUSTER_CACHE_SIZE + 1;
+    starts.push_back(start);
+    int misses = 0;
+    size_t triangles = 0;
+    for (size_t t = start; t < end; t += 1) {
+      misses += clusterCacheMisses(&indices[t * 3], loadedAt, time);
+      triangles += 1;
+      if (misses <= allowedRatio * triangles && t + 1 < end) {
+        starts.push_back(t + 1);
+        time += CLUSTER_CACHE_SIZE + 1;
+        misses = 0;
+        triangles = 0;
+      }
+    }
+  }
+  starts.push_back(triangleCount);
+
+  // each cluster's center and the way it faces, weighted by the area of its triangles
+  size_t clusterCount = starts.size() - 1;
+  std::vector<glm::vec3> centers(clusterCount, glm::vec3(0));
+  std::vector<glm::vec3> normals(clusterCount, glm::vec3(0));
+  std::vector<float> areas(clusterCount, 0);
+  glm::vec3 meshCenter = {0, 0, 0};
+  float meshArea = 0;
+  for (size_t c = 0; c < clusterCount; c += 1) {
+    for (size_t t = starts[c]; t < starts[c + 1]; t += 1) {
+      const VBOVertex &a = data[indices[t * 3]];
+      const VBOVertex &b = data[indices[t * 3 + 1]];
+      const VBOVertex &d = data[indices[t * 3 + 2]];
+      glm::vec3 p0 = {a.x, a.y, a.z};
+      glm::vec3 p1 = {b.x, b.y, b.z};
+      glm::vec3 p2 = {d.x, d.y, d.z};
+      glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      float area = glm::length(normal);
+      centers[c] += (p0 + p1 + p2) * (area / 3);
+      normals[c] += normal;
+      areas[c] += area;
+    }
+    meshCenter += centers[c];
+    meshArea += areas[c];
+  }
+  if (meshArea > 0) {
+    meshCenter /= meshArea;
+  }
+  std::vector<float> facing(clusterCount, 0);
+  for (size_t c = 0; c < clusterCount; c += 1) {
+    float normalLength = glm::length(normals[c]);
+    if (areas[c] > 0 && normalLength > 0) {
+      facing[c] = glm::dot(centers[c] / areas[c] - meshCenter, normals[c] / normalLength);
+    }
+  }
+
+  std::vector<size_t> order(clusterCount);
+  for (size_t c = 0; c < clusterCount; c += 1) {
+    order[c] = c;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return facing[a] > facing[b];
+  });
+  std::vector<GLuint> result;
+  result.reserve(indices.size());
+  for (size_t c : order) {
+    result.insert(result.end(), indices.begin() + starts[c] * 3, indices.begin() + starts[c + 1] * 3);
+  }
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+OBJModel optimizeOBJ(const OBJModel &model) {
+  // one face per triangle, so the triangles encodeOBJ makes line up with the faces
+  OBJModel triangles = model;
+  triangles.faces.clear();
+  for (const Face &face : model.faces) {
+    const std::vector<VertexDescriptor> &corners = face.vertexDescriptors;
+    for (size_t i = 2; i < corners.size(); i += 1) {
+      triangles.faces.push_back({{corners[0], corners[i - 1], corners[i]}});
+    }
+  }
   std::vector<VBOVertex> data;
   std::vector<GLuint> indices;
-  if (!encodeOBJ(model, data, indices)) {
+  if (!encodeOBJ(triangles, data, indices)) {
+    // leave it for setVBOfromOBJ to reject
+    return model;
+  }
+  // a descriptor of each encoded vertex. any that encoded to it will do, as they're equal
+  std::vector<VertexDescriptor> descriptors(data.size());
+  for (size_t i = 0; i < indices.size(); i += 1) {
+    descriptors[indices[i]] = triangles.faces[i / 3].vertexDescriptors[i % 3];
+  }
+  optimizeVertexCache(indices, data.size());
+  optimizeOverdraw(indices, data);
+  // encoding the reordered faces again also numbers the vertices in the order they're used
+  for (size_t t = 0; t < triangles.faces.size(); t += 1) {
+    triangles.faces[t] = {{descriptors[indices[t * 3]], descriptors[indices[t * 3 + 1]], descriptors[indices[t * 3 + 2]]}};
+  }
+  return triangles;
+}
+
+void Mesh::setVBOfromOBJ(const OBJModel &model) {
+  RenderCache cache;
+  if (!encodeOBJ(model, cache.vertices, cache.indices)) {
     throw std::invalid_argument("Invalid OBJ cannot be loaded into VBO.");
   }
-  RenderCache cache = {data, indices, model.mtl.mapKD};
+  cache.texture = model.mtl.mapKD;
   setVBO(cache);
 }
 
 void Mesh::setVBO(RenderCache &cache) {
-  vboSize = cache.vertices.size();
-  bufferSize = cache.indices.size();
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glBufferData(GL_ARRAY_BUFFER, 						// Kind of buffer we are working with 
-                                            // (e.g. GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER)
-              cache.vertices.size() * sizeof(VBOVertex), 	// Size of data in bytes
-              cache.vertices.data(), 											// Raw array of data
-              GL_STATIC_DRAW);
-  // set up indexing
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, cache.indices.size() * sizeof(GLuint), cache.indices.data(), GL_STATIC_DRAW);
+  packed = arena != nullptr;
+  chunkOrigin = cache.origin;
+  bounds = cacheBounds(cache);
+  if (arena != nullptr) {
+    arena->release(range);
+  }
+  if (packed) {
+    vboSize = cache.chunkVertices.size();
+    // chunks of only air keep an empty range, taking no slot until they have vertices
+    if (vboSize > 0) {
+      range = arena->allocate(vboSize + PACKED_MESH_SPARE_QUADS * 4, chunkOrigin);
+      arena->write(range, 0, cache.chunkVertices.data(), vboSize);
+    }
+    // packed meshes draw with the scene's shared quad indices
+    bufferSize = vboSize / 4 * 6;
+  } else {
+    vboSize = cache.vertices.size();
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, 						// Kind of buffer we are working with 
+                                              // (e.g. GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER)
+                cache.vertices.size() * sizeof(VBOVertex), 	// Size of data in bytes
+                cache.vertices.data(), 											// Raw array of data
+                GL_STATIC_DRAW);
+    // set up indexing
+    bufferSize = cache.indices.size();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, cache.indices.size() * sizeof(GLuint), cache.indices.data(), GL_STATIC_DRAW);
+  }
+  // after writing, so the translucent copy carries the slot
+  setPasses(cache);
   glBindVertexArray(0);
 }
 
+void Mesh::updateVBO(RenderCache &cache, size_t firstVertex) {
+  size_t vertexCount = cache.chunkVertices.size();
+  if (!packed || vertexCount == 0 || vertexCount > range.count) {
+    setVBO(cache);
+    return;
+  }
+  firstVertex = std::min(firstVertex, vertexCount);
+  arena->write(range, firstVertex, cache.chunkVertices.data() + firstVertex, vertexCount - firstVertex);
+  vboSize = vertexCount;
+  bufferSize = vertexCount / 4 * 6;
+  bounds = cacheBounds(cache);
+  setPasses(cache);
+}
+
+void Mesh::setPasses(RenderCache &cache) {
+  std::copy(&cache.faceVertices[0][0], &cache.faceVertices[0][0] + RENDER_PASSES * 6, &faceVertices[0][0]);
+  size_t translucentStart = getPassStart(PASS_TRANSLUCENT);
+  translucentVertices.assign(
+    cache.chunkVertices.begin() + std::min(translucentStart, cache.chunkVertices.size()),
+    cache.chunkVertices.begin() + std::min(translucentStart + getPassVertices(PASS_TRANSLUCENT), cache.chunkVertices.size()));
+  sorted = false;
+}
+
+size_t Mesh::getPassStart(RenderPass pass) {
+  size_t start = 0;
+  for (int i = 0; i < pass; i += 1) {
+    start += getPassVertices(RenderPass(i));
+  }
+  return start;
+}
+
+size_t Mesh::getPassVertices(RenderPass pass) {
+  size_t count = 0;
+  for (int d = 0; d < 6; d += 1) {
+    count += faceVertices[pass][d];
+  }
+  return count;
+}
+
+size_t Mesh::getFaceVertices(RenderPass pass, int direction) {
+  return faceVertices[pass][direction];
+}
+
+void Mesh::sortTranslucent(glm::vec3 eye) {
+  if (translucentVertices.empty() || (sorted && glm::distance(eye, sortedFrom) < 1.0f)) {
+    return;
+  }
+  // the scratch space is shared, as only the drawing thread sorts
+  static std::vector<std::pair<float, size_t>> order;
+  static std::vector<ChunkVertex> sortedVertices;
+  order.clear();
+  for (size_t quad = 0; quad < translucentVertices.size() / 4; quad += 1) {
+    glm::vec3 center = glm::vec3(0);
+    for (int corner = 0; corner < 4; corner += 1) {
+      ChunkVertex &vertex = translucentVertices[quad * 4 + corner];
+      center += glm::vec3(vertex.x, vertex.y, vertex.z) * 0.25f;
+    }
+    glm::vec3 offset = center - eye;
+    order.push_back({glm::dot(offset, offset), quad});
+  }
+  std::sort(order.begin(), order.end(), [](const std::pair<float, size_t> &a, const std::pair<float, size_t> &b) {
+    return a.first > b.first;
+  });
+  sortedVertices.clear();
+  for (auto &entry : order) {
+    auto first = translucentVertices.begin() + entry.second * 4;
+    sortedVertices.insert(sortedVertices.end(), first, first + 4);
+  }
+  arena->write(range, getPassStart(PASS_TRANSLUCENT), sortedVertices.data(), sortedVertices.size());
+  sortedFrom = eye;
+  sorted = true;
+}
+
 GLuint Mesh::getVBO() {
   return vbo;
 }
 
+size_t Mesh::getFirstVertex() {
+  return range.first;
+}
+
 size_t Mesh::getVBOSize() {
   return vboSize;
 }
@@ -182,6 +542,38 @@ glm::vec3 Mesh::getPosition() {
   return position;
 }
 
+bool Mesh::isTiled() {
+  return tiled;
+}
+
+uint32_t Mesh::getMaterial() {
+  return material;
+}
+
+void Mesh::setMaterial(uint32_t id) {
+  material = id;
+}
+
+bool Mesh::isPacked() {
+  return packed;
+}
+
+glm::vec3 Mesh::getChunkOrigin() {
+  return chunkOrigin;
+}
+
+AABB Mesh::getBounds() {
+  return bounds;
+}
+
+bool Mesh::isOccluded() {
+  return occluded;
+}
+
+void Mesh::setOccluded(bool hidden) {
+  occluded = hidden;
+}
+
 OBJModel& Mesh::getBaseModel() {
   return baseModel;
 }
@@ -214,34 +606,219 @@ Mesh::Mesh(GLuint vao, OBJModel model) {
   setVBOfromOBJ(model);
 }
 
-Mesh::Mesh(GLuint vao, RenderCache cache) {
-  initializeVAO(vao);
+Mesh::Mesh(RenderCache &cache, ChunkArena &arena) : arena(&arena) {
   baseModel.mtl.mapKD = cache.texture;
+  tiled = cache.tiled;
   setVBO(cache);
 }
 
 void Mesh::clearBuffers() {
+  if (arena != nullptr) {
+    arena->release(range);
+    return;
+  }
   glDeleteBuffers(1, &vbo);
   glDeleteBuffers(1, &buffer);
 }
 
-Scene::Scene(int w, int h, Camera &camera): camera(camera) {
-  pipeline = CreateGraphicsPipeline();
+// fill an index buffer for a run of quads that each follow QUAD_INDEX_PATTERN
+template <typename Index>
+void uploadQuadIndices(GLuint buffer, size_t quads) {
+  std::vector<Index> indices(quads * 6);
+  for (size_t quad = 0; quad < quads; quad += 1) {
+    for (int i = 0; i < 6; i += 1) {
+      indices[quad * 6 + i] = Index(quad * 4 + QUAD_INDEX_PATTERN[i]);
+    }
+  }
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(Index), indices.data(), GL_STATIC_DRAW);
+}
+
+ChunkArena::ChunkArena() {
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &originBuffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, originBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, CHUNK_ARENA_SLOTS * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+  glGenTextures(1, &originTexture);
+  glBindTexture(GL_TEXTURE_BUFFER, originTexture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, originBuffer);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  // handed out from slot 0 up
+  for (size_t slot = CHUNK_ARENA_SLOTS; slot > 0; slot -= 1) {
+    freeSlots.push_back(uint16_t(slot - 1));
+  }
+  grow(CHUNK_ARENA_VERTICES);
+}
+
+ChunkArena::~ChunkArena() {
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &originBuffer);
+  glDeleteTextures(1, &originTexture);
+  glDeleteVertexArrays(1, &vao);
+}
+
+void ChunkArena::grow(size_t vertices) {
+  size_t newCapacity = std::max(capacity, CHUNK_ARENA_VERTICES);
+  while (newCapacity < vertices) {
+    newCapacity *= 2;
+  }
+  GLuint newVBO;
+  glGenBuffers(1, &newVBO);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+  glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * sizeof(ChunkVertex), nullptr, GL_DYNAMIC_DRAW);
+  if (vbo != 0) {
+    // ranges keep their place, so the meshes in them don't notice the move
+    glBindBuffer(GL_COPY_READ_BUFFER, vbo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, capacity * sizeof(ChunkVertex));
+    glDeleteBuffers(1, &vbo);
+  }
+  vbo = newVBO;
+  // the new space joins whatever free range ran up to the old end
+  size_t first = capacity;
+  auto last = freeRanges.empty() ? freeRanges.end() : std::prev(freeRanges.end());
+  if (last != freeRanges.end() && last->first + last->second == capacity) {
+    first = last->first;
+    freeRanges.erase(last);
+  }
+  freeRanges[first] = newCapacity - first;
+  capacity = newCapacity;
+  // point the vertex array at the new buffer
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  // position and normal index (x,y,z,normal)
+  glEnableVertexAttribArray(3);
+  glVertexAttribIPointer(3, 4, GL_UNSIGNED_BYTE, sizeof(ChunkVertex), (void*)0);
+  // block type, corner and slot
+  glEnableVertexAttribArray(4);
+  glVertexAttribIPointer(4, 4, GL_UNSIGNED_BYTE, sizeof(ChunkVertex), (GLvoid*)(sizeof(GLubyte)*4));
+  glBindVertexArray(0);
+}
+
+ChunkArena::Range ChunkArena::allocate(size_t count, glm::vec3 origin) {
+  if (freeSlots.empty()) {
+    throw std::length_error("Chunk arena has no slots left.");
+  }
+  // the first free range it fits in, making room at the end if there is none
+  auto fit = freeRanges.begin();
+  while (fit != freeRanges.end() && fit->second < count) {
+    fit++;
+  }
+  if (fit == freeRanges.end()) {
+    grow(capacity + count);
+    fit = std::prev(freeRanges.end());
+  }
+  Range range;
+  range.first = fit->first;
+  range.count = count;
+  size_t left = fit->second - count;
+  freeRanges.erase(fit);
+  if (left > 0) {
+    freeRanges[range.first + count] = left;
+  }
+  range.slot = freeSlots.back();
+  freeSlots.pop_back();
+  glm::vec4 slotOrigin = glm::vec4(origin, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, originBuffer);
+  glBufferSubData(GL_TEXTURE_BUFFER, range.slot * sizeof(glm::vec4), sizeof(glm::vec4), &slotOrigin[0]);
+  return range;
+}
+
+void ChunkArena::release(Range &range) {
+  if (range.slot < 0) {
+    return;
+  }
+  freeSlots.push_back(uint16_t(range.slot));
+  size_t first = range.first;
+  size_t count = range.count;
+  range = Range();
+  if (count == 0) {
+    return;
+  }
+  // merge with the free ranges on either side
+  auto next = freeRanges.lower_bound(first);
+  if (next != freeRanges.end() && first + count == next->first) {
+    count += next->second;
+    next = freeRanges.erase(next);
+  }
+  if (next != freeRanges.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == first) {
+      previous->second += count;
+      return;
+    }
+  }
+  freeRanges[first] = count;
+}
+
+void ChunkArena::write(const Range &range, size_t offset, ChunkVertex* vertices, size_t count) {
+  for (size_t i = 0; i < count; i += 1) {
+    vertices[i].setSlot(range.slot);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferSubData(GL_ARRAY_BUFFER, (range.first + offset) * sizeof(ChunkVertex), count * sizeof(ChunkVertex), vertices);
+}
+
+void ChunkArena::bind(GLuint quadIndices) {
+  glBindVertexArray(vao);
+  // the index buffer is part of the vertex array, so it only changes for the odd wide mesh
+  if (quadIndices != elementBuffer) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadIndices);
+    elementBuffer = quadIndices;
+  }
+  glActiveTexture(GL_TEXTURE0 + CHUNK_ORIGIN_TEXTURE_UNIT);
+  glBindTexture(GL_TEXTURE_BUFFER, originTexture);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+Scene::Scene(int w, int h, Camera &camera): camera(camera), occlusion(OCCLUSION_WIDTH, OCCLUSION_WIDTH * h / w) {
+  pipelines[PASS_OPAQUE] = CreateGraphicsPipeline();
+  pipelines[PASS_CUTOUT] = CreateGraphicsPipeline("#define CUTOUT\n");
+  pipelines[PASS_TRANSLUCENT] = CreateGraphicsPipeline("#define TRANSLUCENT\n");
+  pipeline = pipelines[PASS_OPAQUE];
+  glGenBuffers(1, &frameUniformBuffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, frameUniformBuffer);
+  for (int pass = 0; pass < RENDER_PASSES; pass += 1) {
+    pipelineUniforms[pass] = resolveUniforms(pipelines[pass]);
+  }
+  glUseProgram(0);
+  uniforms = &pipelineUniforms[PASS_OPAQUE];
+  materials.push_back(Material());
   width = w;
   height = h;
   fov = glm::radians(45.0f);
+  viewDistance = 40.0f;
   setupVertexArrayObject();
+  glGenBuffers(1, &quadIndices);
+  uploadQuadIndices<GLushort>(quadIndices, SHORT_INDEX_QUADS);
+  glGenBuffers(1, &instanceBuffer);
+  instanceCapacity = INSTANCE_BUFFER_MATRICES;
 }
 
 Scene::~Scene() {
-  for (auto mesh : meshes) {
-    deleteMesh(mesh.first);
+  for (MeshEntry &entry : meshes) {
+    entry.mesh->clearBuffers();
+    delete entry.mesh;
   }
   for (auto light : lights) {
     deleteLight(light.first);
   }
+  glDeleteBuffers(1, &quadIndices);
+  glDeleteBuffers(1, &frameUniformBuffer);
+  glDeleteBuffers(1, &instanceBuffer);
+  for (InstancedModel &model : models) {
+    model.mesh->clearBuffers();
+    delete model.mesh;
+  }
+  if (wideQuadIndices != 0) {
+    glDeleteBuffers(1, &wideQuadIndices);
+  }
   glDeleteVertexArrays(1, &vao);
-  glDeleteProgram(pipeline);
+  for (GLuint program : pipelines) {
+    glDeleteProgram(program);
+  }
 }
 
 void Scene::setupVertexArrayObject() {
@@ -266,57 +843,105 @@ bool tryLoadingTexture(std::string path, std::unordered_map<std::string, Texture
   return true;
 }
 
-bool Scene::createMesh(std::string name, OBJModel obj) {
-  if (meshes.find(name) != meshes.end()) {
-    return false;
+uint32_t Scene::findMaterial(const std::string &texture, bool tiled) {
+  tryLoadingTexture(texture, textures);
+  Material material;
+  if (textures.find(texture) != textures.end()) {
+    material.texture = textures[texture];
+  }
+  material.tiled = tiled;
+  for (size_t id = 0; id < materials.size(); id += 1) {
+    if (materials[id].texture == material.texture && materials[id].tiled == material.tiled) {
+      return id;
+    }
+  }
+  materials.push_back(material);
+  return materials.size() - 1;
+}
+
+MeshHandle Scene::addMesh(Mesh* mesh) {
+  uint32_t slot;
+  if (freeMeshSlots.empty()) {
+    slot = meshSlots.size();
+    meshSlots.push_back({1, 0});
+  } else {
+    slot = freeMeshSlots.back();
+    freeMeshSlots.pop_back();
+  }
+  meshSlots[slot].entry = meshes.size();
+  meshes.push_back({mesh, slot, false});
+  return {slot, meshSlots[slot].generation};
+}
+
+Scene::MeshEntry* Scene::findMesh(MeshHandle handle) {
+  if (handle.index >= meshSlots.size() || meshSlots[handle.index].generation != handle.generation) {
+    return nullptr;
+  }
+  return &meshes[meshSlots[handle.index].entry];
+}
+
+MeshHandle Scene::createMesh(OBJModel obj, bool optimize) {
+  if (optimize) {
+    obj = optimizeOBJ(obj);
   }
-  // std::cout << "creating mesh" << std::endl;
   Mesh* mesh = new Mesh(vao, obj);
-  // std::cout << "storing mesh" << std::endl;
-  meshes[name] = mesh;
-  tryLoadingTexture(obj.mtl.mapKD, textures);
-  
-  // std::cout << "done storing mesh" << std::endl;
-  return true;
+  mesh->setMaterial(findMaterial(obj.mtl.mapKD, mesh->isTiled()));
+  return addMesh(mesh);
 }
 
-bool Scene::createMeshFromCache(std::string name, RenderCache cache) {
-  if (meshes.find(name) != meshes.end()) {
-    return false;
+MeshHandle Scene::createMeshFromCache(RenderCache &cache) {
+  Mesh* mesh = new Mesh(cache, chunkArena);
+  mesh->setMaterial(findMaterial(cache.texture, cache.tiled));
+  return addMesh(mesh);
+}
+
+MeshHandle Scene::updateMeshFromCache(MeshHandle handle, RenderCache &cache, size_t firstVertex) {
+  MeshEntry* entry = findMesh(handle);
+  if (entry == nullptr) {
+    return createMeshFromCache(cache);
   }
-  // std::cout << "creating mesh" << std::endl;
-  Mesh* mesh = new Mesh(vao, cache);
-  // std::cout << "storing mesh" << std::endl;
-  meshes[name] = mesh;
-  tryLoadingTexture(cache.texture, textures);
-  
-  // std::cout << "done storing mesh" << std::endl;
-  return true;
+  entry->mesh->updateVBO(cache, firstVertex);
+  return handle;
 }
 
-Mesh* Scene::getMesh(std::string name) {
-  return meshes[name];
+Mesh* Scene::getMesh(MeshHandle handle) {
+  MeshEntry* entry = findMesh(handle);
+  return entry == nullptr ? nullptr : entry->mesh;
 }
 
-void Scene::deleteMesh(std::string name) {
-  if (meshes.find(name) == meshes.end()) {
+void Scene::deleteMesh(MeshHandle handle) {
+  MeshEntry* entry = findMesh(handle);
+  if (entry == nullptr) {
     return;
   }
-  meshes[name]->clearBuffers();
-  delete meshes[name];
-  meshes.erase(name);
+  entry->mesh->clearBuffers();
+  delete entry->mesh;
+  // the last entry fills the gap, so the rest stay packed
+  uint32_t place = meshSlots[handle.index].entry;
+  meshes[place] = meshes.back();
+  meshSlots[meshes[place].slot].entry = place;
+  meshes.pop_back();
+  meshSlots[handle.index].generation += 1;
+  freeMeshSlots.push_back(handle.index);
 }
 
-void Scene::hideMesh(std::string name) {
-  hiddenMeshes.insert(name);
+void Scene::hideMesh(MeshHandle handle) {
+  MeshEntry* entry = findMesh(handle);
+  if (entry != nullptr) {
+    entry->hidden = true;
+  }
 }
 
-void Scene::showMesh(std::string name) {
-  hiddenMeshes.erase(name);
+void Scene::showMesh(MeshHandle handle) {
+  MeshEntry* entry = findMesh(handle);
+  if (entry != nullptr) {
+    entry->hidden = false;
+  }
 }
 
-bool Scene::meshHidden(std::string name) {
-  return hiddenMeshes.find(name) != hiddenMeshes.end();
+bool Scene::meshHidden(MeshHandle handle) {
+  MeshEntry* entry = findMesh(handle);
+  return entry != nullptr && entry->hidden;
 }
 
 bool Scene::createLight(std::string name, PointLight data) {
@@ -360,7 +985,7 @@ void Scene::setBackground(glm::vec3 color) {
 }
 
 // get the uniform location and run generic checks
-GLint Scene::checkedUniformLocation(std::string uniformName) {
+GLint checkedUniformLocation(GLuint pipeline, std::string uniformName) {
   const GLchar* chars = uniformName.c_str();
   GLint u_Name = glGetUniformLocation(pipeline, chars);
   if (u_Name < 0){
@@ -370,50 +995,66 @@ GLint Scene::checkedUniformLocation(std::string uniformName) {
   return u_Name;
 }
 
-// a convenient method for transferring lighting info to the shader
-void Scene::setPointLightUniform(PointLight light, int index) {
-  std::string location = "u_pointLights[" + std::to_string(index) + "].";
-
-  GLint u_lightColor = checkedUniformLocation(location + "lightColor");
-  glUniform3fv(u_lightColor, 1, &light.lightColor[0]);
-
-  GLint u_lightPos = checkedUniformLocation(location + "lightPos");
-  glUniform3fv(u_lightPos, 1, &light.lightPos[0]);
-
-  GLint u_ambientIntensity = checkedUniformLocation(location + "ambientIntensity");
-  glUniform1f(u_ambientIntensity, light.ambientIntensity);
-
-  GLint u_specularStrength = checkedUniformLocation(location + "specularStrength");
-  glUniform1f(u_specularStrength, light.specularStrength);
-}
-
-void Scene::setSunUniform(Sun sun, int index) {
-  std::string location = "u_suns[" + std::to_string(index) + "].";
-
-  GLint u_color = checkedUniformLocation(location + "color");
-  glUniform3fv(u_color, 1, &sun.color[0]);
+PipelineUniforms Scene::resolveUniforms(GLuint program) {
+  glUseProgram(program);
+  // Model transformation by translating our object into world space
+  glm::mat4 model = glm::translate(glm::mat4(1.0f),glm::vec3(0.0f,0.0f,0.0f));
+  glUniformMatrix4fv(checkedUniformLocation(program, "u_ModelMatrix"), 1, GL_FALSE, &model[0][0]);
+  glUniform1i(checkedUniformLocation(program, "u_DiffuseTexture"), 0);
+  glUniform1i(checkedUniformLocation(program, "u_ChunkOrigins"), CHUNK_ORIGIN_TEXTURE_UNIT);
+
+  GLuint block = glGetUniformBlockIndex(program, "FrameUniforms");
+  if (block == GL_INVALID_INDEX) {
+    std::cout << "Could not find FrameUniforms, maybe a mispelling?\n";
+    exit(EXIT_FAILURE);
+  }
+  glUniformBlockBinding(program, block, FRAME_UNIFORMS_BINDING);
 
-  GLint u_direction = checkedUniformLocation(location + "direction");
-  glUniform3fv(u_direction, 1, &sun.direction[0]);
+  PipelineUniforms resolved;
+  resolved.tiledTexture = checkedUniformLocation(program, "u_TiledTexture");
+  resolved.packedChunk = checkedUniformLocation(program, "u_PackedChunk");
+  resolved.instanced = checkedUniformLocation(program, "u_Instanced");
+  return resolved;
 }
 
 void Scene::uploadUniforms() {
+  frameUniforms = FrameUniforms();
+  frameUniforms.viewMatrix = viewMatrix;
+  frameUniforms.projection = projectionMatrix;
+  frameUniforms.viewPosition = glm::vec3(camera.getPosition());
   int count = 0;
   for (auto light : lights) {
-    setPointLightUniform(*light.second, count);
+    if (count == MAX_POINT_LIGHTS) {
+      break;
+    }
+    frameUniforms.pointLights[count].lightColor = light.second->lightColor;
+    frameUniforms.pointLights[count].ambientIntensity = light.second->ambientIntensity;
+    frameUniforms.pointLights[count].lightPos = light.second->lightPos;
+    frameUniforms.pointLights[count].specularStrength = light.second->specularStrength;
     count += 1;
   }
   count = 0;
   for (auto sun : suns) {
-    setSunUniform(*sun.second, count);
+    if (count == MAX_SUNS) {
+      break;
+    }
+    frameUniforms.suns[count].color = sun.second->color;
+    frameUniforms.suns[count].direction = sun.second->direction;
     count += 1;
   }
+  glBindBuffer(GL_UNIFORM_BUFFER, frameUniformBuffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frameUniforms);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void Scene::setFOV(float newFOV) {
   fov = newFOV;
 }
 
+void Scene::setViewDistance(float distance) {
+  viewDistance = distance;
+}
+
 void Scene::predraw() {
   glEnable(GL_DEPTH_TEST);                    // NOTE: Need to enable DEPTH Test
   glEnable(GL_CULL_FACE);
@@ -429,35 +1070,63 @@ void Scene::predraw() {
   //Clear color buffer and Depth Buffer
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-  // Use our shader
-	glUseProgram(pipeline);
-
-  // Model transformation by translating our object into world space
-  glm::mat4 model = glm::translate(glm::mat4(1.0f),glm::vec3(0.0f,0.0f,0.0f)); 
-
-  // Retrieve our location of our Model Matrix
-  GLint u_ModelMatrixLocation = checkedUniformLocation("u_ModelMatrix");
-  glUniformMatrix4fv(u_ModelMatrixLocation,1,GL_FALSE,&model[0][0]);
-
-  // Update the View Matrix
-  GLint u_ViewMatrixLocation = checkedUniformLocation("u_ViewMatrix");
-  glm::mat4 viewMatrix = camera.GetViewMatrix();
-  glUniformMatrix4fv(u_ViewMatrixLocation,1,GL_FALSE,&viewMatrix[0][0]);
+  viewMatrix = camera.GetViewMatrix();
+  // Projection matrix (in perspective)
+  projectionMatrix = glm::perspective(fov, (float) width / height, 0.1f, viewDistance);
+  frustum = extractFrustum(projectionMatrix * viewMatrix);
+}
 
-  // Projection matrix (in perspective) 
-  glm::mat4 perspective = glm::perspective(
-    fov, (float) width / height, 0.1f, 40.0f);
+void Scene::cullMeshes() {
+  visibleMeshes.clear();
+  meshBounds.clear();
+  frameStats.occluded = 0;
+  for (MeshEntry &entry : meshes) {
+    // empty meshes have nothing to draw, and no bounds to cull by
+    if (entry.mesh->getVBOSize() == 0) {
+      continue;
+    }
+    if (entry.mesh->isOccluded()) {
+      frameStats.occluded += 1;
+    } else if (!entry.hidden) {
+      visibleMeshes.push_back(entry.mesh);
+      meshBounds.add(entry.mesh->getBounds());
+    }
+  }
+  size_t inView = meshBounds.cull(frustum, meshVisible);
+  frameStats.culled = visibleMeshes.size() - inView;
+  // draw the occluders on the CPU, then keep only the meshes in view that reach out from behind them
+  bool occluding = !occluders.empty();
+  if (occluding) {
+    occlusion.clear(projectionMatrix * viewMatrix);
+    for (size_t i = 0; i + 4 <= occluders.size(); i += 4) {
+      occlusion.rasterizeQuad(&occluders[i]);
+    }
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < visibleMeshes.size(); i += 1) {
+    if (meshVisible[i] && (!occluding || occlusion.visible(visibleMeshes[i]->getBounds()))) {
+      visibleMeshes[kept] = visibleMeshes[i];
+      kept += 1;
+    }
+  }
+  visibleMeshes.resize(kept);
+  frameStats.drawn = kept;
+  frameStats.hidden = inView - kept;
+}
 
-  // Retrieve our location of our perspective matrix uniform 
-  GLint u_ProjectionLocation = checkedUniformLocation("u_Projection");
-  glUniformMatrix4fv(u_ProjectionLocation,1,GL_FALSE,&perspective[0][0]);
+FrameStats Scene::getFrameStats() {
+  return frameStats;
+}
 
-  GLint u_viewPosition = checkedUniformLocation("u_viewPosition");
-  glm::vec3 cameraPosition = glm::vec3(camera.getPosition());
-  glUniform3fv(u_viewPosition, 1, &cameraPosition[0]);
+void Scene::setOccluders(const std::vector<glm::vec3> &corners) {
+  occluders = corners;
+}
 
-  GLint u_DiffuseTexture = checkedUniformLocation("u_DiffuseTexture");
-  glUniform1i(u_DiffuseTexture, 0);
+void Scene::usePass(RenderPass pass) {
+  // Use our shader
+  pipeline = pipelines[pass];
+  uniforms = &pipelineUniforms[pass];
+	glUseProgram(pipeline);
 }
 
 void setupVAO() {
@@ -478,29 +1147,290 @@ void closeVAO() {
   glDisableVertexAttribArray(2);
 }
 
-void Scene::draw(){
-  predraw();
-  // Enable our attributes
-	glBindVertexArray(vao);
-  uploadUniforms();
-  //Render data
-  for (auto entry : meshes) {
-    if (meshHidden(entry.first)) {
-	    glBindVertexArray(0);
-      continue;
+AABB cacheBounds(const RenderCache &cache) {
+  AABB bounds;
+  if (!cache.chunkVertices.empty()) {
+    // found in blocks from the origin, then placed as the vertex shader does
+    glm::ivec3 low = glm::ivec3(255);
+    glm::ivec3 high = glm::ivec3(0);
+    for (const ChunkVertex &v : cache.chunkVertices) {
+      glm::ivec3 position = glm::ivec3(v.x, v.y, v.z);
+      low = glm::min(low, position);
+      high = glm::max(high, position);
+    }
+    bounds.min = (cache.origin + glm::vec3(low) - 0.5f) * CHUNK_VERTEX_SCALE;
+    bounds.max = (cache.origin + glm::vec3(high) - 0.5f) * CHUNK_VERTEX_SCALE;
+  } else if (!cache.vertices.empty()) {
+    bounds.min = glm::vec3(INFINITY);
+    bounds.max = glm::vec3(-INFINITY);
+    for (const VBOVertex &v : cache.vertices) {
+      glm::vec3 position = glm::vec3(v.x, v.y, v.z);
+      bounds.min = glm::min(bounds.min, position);
+      bounds.max = glm::max(bounds.max, position);
+    }
+  }
+  return bounds;
+}
+
+uint8_t facingDirections(glm::vec3 eye) {
+  // a face is only seen from in front of it, and a chunk's faces lie on planes from 0 to
+  // CHUNK_SIZE blocks out along each axis. the positive directions come first in each pair
+  // must match CHUNK_SIZE
+  const float chunkSize = 16;
+  uint8_t facing = 0;
+  for (int axis = 0; axis < 3; axis += 1) {
+    facing |= uint8_t(eye[axis] > 0) << (axis * 2);
+    facing |= uint8_t(eye[axis] < chunkSize) << (axis * 2 + 1);
+  }
+  return facing;
+}
+
+void Scene::reserveWideQuadIndices(size_t quads) {
+  if (quads <= wideQuadCapacity) {
+    return;
+  }
+  if (wideQuadIndices == 0) {
+    glGenBuffers(1, &wideQuadIndices);
+  }
+  // grow in doubling steps so a growing mesh doesn't refill the buffer every frame
+  wideQuadCapacity = std::max(quads, wideQuadCapacity * 2);
+  uploadQuadIndices<GLuint>(wideQuadIndices, wideQuadCapacity);
+}
+
+void Scene::drawChunks(const std::vector<Mesh*> &chunks, RenderPass pass) {
+  // one index type for the whole call, so only meshes too big for 16 bit indices bring in 32 bit ones
+  size_t widest = 0;
+  for (Mesh* mesh : chunks) {
+    widest = std::max(widest, mesh->getVBOSize());
+  }
+  bool wide = widest > SHORT_INDEX_QUADS * 4;
+  size_t indexSize = wide ? sizeof(GLuint) : sizeof(GLushort);
+  if (wide) {
+    reserveWideQuadIndices(widest / 4);
+  }
+  drawCounts.clear();
+  drawOffsets.clear();
+  drawBaseVertices.clear();
+  for (Mesh* mesh : chunks) {
+    // translucent quads are sorted by distance across all directions, so they are drawn whole
+    uint8_t facing = pass == PASS_TRANSLUCENT ? 0x3F : facingDirections(chunkEye - mesh->getChunkOrigin());
+    // the facing directions' ranges, merged where they touch. each quad's 4 vertices take 6 indices
+    size_t vertex = mesh->getPassStart(pass);
+    size_t rangeEnd = SIZE_MAX;
+    for (int d = 0; d < 6; d += 1) {
+      size_t count = mesh->getFaceVertices(pass, d);
+      if ((facing >> d & 1) && count > 0) {
+        if (vertex == rangeEnd) {
+          drawCounts.back() += count / 4 * 6;
+        } else {
+          drawOffsets.push_back((void*)(vertex / 4 * 6 * indexSize));
+          drawCounts.push_back(count / 4 * 6);
+          drawBaseVertices.push_back(GLint(mesh->getFirstVertex()));
+        }
+        rangeEnd = vertex + count;
+      }
+      vertex += count;
     }
-    Mesh* mesh = entry.second;
+  }
+  if (drawCounts.empty()) {
+    return;
+  }
+  chunkArena.bind(wide ? wideQuadIndices : quadIndices);
+  glUniform1i(uniforms->packedChunk, true);
+  glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), wide ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, drawOffsets.data(), drawCounts.size(), drawBaseVertices.data());
+  glBindVertexArray(vao);
+}
 
-    std::string diffusePath = mesh->getBaseModel().mtl.mapKD;
-    if (textures.find(diffusePath) != textures.end()) {
-      textures[diffusePath]->Bind(0);
+void Scene::drawMesh(Mesh* mesh) {
+  glUniform1i(uniforms->packedChunk, false);
+
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->getVBO());
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->getElementBuffer());
+  setupVAO();
+  glDrawElements(GL_TRIANGLES, mesh->getElementBufferSize(), GL_UNSIGNED_INT, (void*)(0 * sizeof(GLuint)));
+  closeVAO();
+}
+
+uint64_t drawKey(RenderPass pass, bool packed, uint32_t material, float distance) {
+  // non-negative floats order the same as their bits
+  uint32_t depth;
+  std::memcpy(&depth, &distance, sizeof(depth));
+  material &= 0x1FFFFFFF;
+  uint64_t key = uint64_t(pass) << 62;
+  if (pass == PASS_TRANSLUCENT) {
+    return key | uint64_t(~depth) << 30 | uint64_t(!packed) << 29 | material;
+  }
+  return key | uint64_t(!packed) << 61 | uint64_t(material) << 32 | depth;
+}
+
+RenderPass drawKeyPass(uint64_t key) {
+  return RenderPass(key >> 62);
+}
+
+void Scene::queueDraws() {
+  renderQueue.clear();
+  glm::vec3 eye = camera.getPosition();
+  for (Mesh* mesh : visibleMeshes) {
+    AABB bounds = mesh->getBounds();
+    glm::vec3 offset = (bounds.min + bounds.max) * 0.5f - eye;
+    float distance = glm::dot(offset, offset);
+    // meshes that aren't packed have no passes of their own, and may discard texels
+    if (!mesh->isPacked()) {
+      renderQueue.push_back({drawKey(PASS_CUTOUT, false, mesh->getMaterial(), distance), mesh});
+      continue;
     }
+    for (int pass = 0; pass < RENDER_PASSES; pass += 1) {
+      if (mesh->getPassVertices(RenderPass(pass)) > 0) {
+        renderQueue.push_back({drawKey(RenderPass(pass), true, mesh->getMaterial(), distance), mesh});
+      }
+    }
+    // translucent quads are also sorted back to front within each chunk
+    if (mesh->getPassVertices(PASS_TRANSLUCENT) > 0) {
+      mesh->sortTranslucent(chunkEye - mesh->getChunkOrigin());
+    }
+  }
+  std::sort(renderQueue.begin(), renderQueue.end(), [](const DrawItem &a, const DrawItem &b) {
+    return a.key < b.key;
+  });
+}
 
+void Scene::switchPass(RenderPass pass) {
+  if (pass == boundPass) {
+    return;
+  }
+  boundPass = pass;
+  boundMaterial = -1;
+  usePass(pass);
+  if (pass == PASS_TRANSLUCENT) {
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+  }
+  frameStats.stateChanges += 1;
+}
+
+void Scene::switchMaterial(uint32_t id) {
+  if (id == boundMaterial) {
+    return;
+  }
+  boundMaterial = id;
+  const Material &material = materials[id];
+  if (material.texture != nullptr) {
+    material.texture->Bind(0);
+  }
+  glUniform1i(uniforms->tiledTexture, material.tiled);
+  frameStats.stateChanges += 1;
+}
+
+uint32_t Scene::createModel(OBJModel obj) {
+  Mesh* mesh = new Mesh(vao, obj);
+  models.push_back({mesh, findMaterial(obj.mtl.mapKD, false), {}});
+  return models.size() - 1;
+}
+
+void Scene::addInstance(uint32_t model, const glm::mat4 &transform) {
+  models[model].instances.push_back(transform);
+}
+
+void Scene::drawInstances() {
+  size_t total = 0;
+  for (InstancedModel &model : models) {
+    total += model.instances.size();
+  }
+  if (total == 0) {
+    return;
+  }
+  switchPass(PASS_CUTOUT);
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  // a new store each frame, so writing it doesn't wait on the last frame's draws
+  if (total > instanceCapacity) {
+    instanceCapacity = std::max(total, instanceCapacity * 2);
+  }
+  glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+  size_t first = 0;
+  for (InstancedModel &model : models) {
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(glm::mat4), model.instances.size() * sizeof(glm::mat4), model.instances.data());
+    first += model.instances.size();
+  }
+  glUniform1i(uniforms->packedChunk, false);
+  glUniform1i(uniforms->instanced, true);
+  first = 0;
+  for (InstancedModel &model : models) {
+    if (model.instances.empty()) {
+      continue;
+    }
+    switchMaterial(model.material);
+    Mesh* mesh = model.mesh;
     glBindBuffer(GL_ARRAY_BUFFER, mesh->getVBO());
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->getElementBuffer());
     setupVAO();
-    glDrawElements(GL_TRIANGLES, mesh->getElementBufferSize(), GL_UNSIGNED_INT, (void*)(0 * sizeof(GLuint)));
+    // a column of the model matrix in each attribute, advancing once per instance
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (GLuint column = 0; column < 4; column += 1) {
+      GLuint attribute = INSTANCE_MATRIX_ATTRIBUTE + column;
+      glEnableVertexAttribArray(attribute);
+      glVertexAttribPointer(attribute, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (GLvoid*)(first * sizeof(glm::mat4) + column * sizeof(glm::vec4)));
+      glVertexAttribDivisor(attribute, 1);
+    }
+    glDrawElementsInstanced(GL_TRIANGLES, mesh->getElementBufferSize(), GL_UNSIGNED_INT, (void*)0, model.instances.size());
+    for (GLuint column = 0; column < 4; column += 1) {
+      glDisableVertexAttribArray(INSTANCE_MATRIX_ATTRIBUTE + column);
+    }
     closeVAO();
+    first += model.instances.size();
+    model.instances.clear();
+  }
+  glUniform1i(uniforms->instanced, false);
+}
+
+void Scene::draw(){
+  predraw();
+  uploadUniforms();
+  chunkEye = camera.getPosition() / CHUNK_VERTEX_SCALE + 0.5f;
+  cullMeshes();
+  queueDraws();
+  // Enable our attributes
+	glBindVertexArray(vao);
+  //Render data
+  // opaque chunk faces first, which need no discard, so the depth test can reject hidden
+  // fragments before they are shaded. then everything that discards texels, which includes
+  // every other model, and last translucent faces, which blend over the rest and leave the
+  // depth buffer alone
+  frameStats.stateChanges = 0;
+  boundPass = -1;
+  boundMaterial = -1;
+  static std::vector<Mesh*> chunks;
+  size_t next = 0;
+  while (next < renderQueue.size()) {
+    RenderPass pass = drawKeyPass(renderQueue[next].key);
+    Mesh* mesh = renderQueue[next].mesh;
+    // instances of models are drawn along with the other models, before anything blends over them
+    if (pass == PASS_TRANSLUCENT && boundPass != PASS_TRANSLUCENT) {
+      drawInstances();
+    }
+    switchPass(pass);
+    switchMaterial(mesh->getMaterial());
+    if (!mesh->isPacked()) {
+      drawMesh(mesh);
+      next += 1;
+      continue;
+    }
+    // the run of packed meshes sharing the pass and material draws in one call
+    chunks.clear();
+    for (; next < renderQueue.size() && drawKeyPass(renderQueue[next].key) == pass; next += 1) {
+      Mesh* chunk = renderQueue[next].mesh;
+      if (!chunk->isPacked() || chunk->getMaterial() != boundMaterial) {
+        break;
+      }
+      chunks.push_back(chunk);
+    }
+    drawChunks(chunks, pass);
+  }
+  if (boundPass == PASS_TRANSLUCENT) {
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+  } else {
+    drawInstances();
   }
 	glBindVertexArray(0);
 
@@ -2,6 +2,9 @@
 #define WORLD_C
 #include "World.hpp"
 #include <math.h>
+#include <array>
+#include <cstring>
+#include <algorithm>
 
 /*
 ** --------- WORLD- ------
@@ -22,6 +25,55 @@ char World::getBlock(glm::ivec3 blockCoordinate) {
   return getChunk(chunkCoordinate).getBlock(localCoordinate);
 }
 
+bool World::setBlock(glm::ivec3 blockCoordinate, uint8_t blockType) {
+  glm::ivec3 chunkCoordinate = World::blockToChunkCoordinate(blockCoordinate);
+  if (!hasChunk(chunkCoordinate)) {
+    return false;
+  }
+  glm::ivec3 localCoordinate = blockCoordinate - chunkCoordinate * CHUNK_SIZE;
+  getChunk(chunkCoordinate).blocks[localCoordinate.z][localCoordinate.y][localCoordinate.x] = blockType;
+  return true;
+}
+
+bool World::castRay(glm::vec3 from, glm::vec3 direction, float reach, glm::ivec3 &hit, glm::ivec3 &before) {
+  direction = glm::normalize(direction);
+  // blocks are centered on their coordinates, so block b spans b - 0.5 to b + 0.5. walk the
+  // blocks the ray passes through one face crossing at a time, as in Amanatides and Woo's
+  // "A Fast Voxel Traversal Algorithm for Ray Tracing"
+  glm::vec3 position = from + 0.5f;
+  glm::ivec3 block = glm::ivec3(glm::floor(position));
+  glm::ivec3 step;
+  // how far along the ray the next face crossing on each axis is, and how far apart they are
+  glm::vec3 nextCrossing;
+  glm::vec3 crossingGap;
+  for (int axis = 0; axis < 3; axis += 1) {
+    step[axis] = direction[axis] > 0 ? 1 : -1;
+    if (direction[axis] == 0) {
+      nextCrossing[axis] = INFINITY;
+      crossingGap[axis] = INFINITY;
+      continue;
+    }
+    float boundary = direction[axis] > 0 ? block[axis] + 1 : block[axis];
+    nextCrossing[axis] = (boundary - position[axis]) / direction[axis];
+    crossingGap[axis] = 1 / std::abs(direction[axis]);
+  }
+  while (true) {
+    int axis = nextCrossing.x < nextCrossing.y
+      ? (nextCrossing.x < nextCrossing.z ? 0 : 2)
+      : (nextCrossing.y < nextCrossing.z ? 1 : 2);
+    if (nextCrossing[axis] > reach) {
+      return false;
+    }
+    before = block;
+    block[axis] += step[axis];
+    nextCrossing[axis] += crossingGap[axis];
+    if (hasBlock(block) && getBlock(block) != BLOCKTYPE_AIR) {
+      hit = block;
+      return true;
+    }
+  }
+}
+
 Chunk& World::getChunk(glm::ivec3 chunkCoordinate) {
   return chunks[chunkCoordinate];
 }
@@ -383,8 +435,9 @@ Hitbox Entity::getHitbox() {
   return hitbox;
 }
 
-OBJModel Entity::getModel() {
-  return UNIT_CUBE();
+const OBJModel& Entity::getModel() {
+  static const OBJModel model = UNIT_CUBE();
+  return model;
 }
 // };
 
@@ -393,7 +446,7 @@ Entity(entityName, initialPosition, facing, initialVelocity) {
   hitbox = {{12.0/16, 30.0/16, 12.0/16}};
 }
 
-OBJModel Player::getModel() {
+const OBJModel& Player::getModel() {
   return Entity::getModel();
 }
 
@@ -412,6 +465,26 @@ void EntityGod::update() {
         // std::cout << "unlock 5" << std::endl;
 }
 
+void EntityGod::drawEntities(Scene &scene, glm::vec3 eye) {
+  for (auto &it : world.entities) {
+    Entity &entity = it.second;
+    glm::vec3 halfSize = entity.hitbox.dimensions * 0.5f;
+    if (glm::all(glm::lessThanEqual(glm::abs(eye - entity.position), halfSize))) {
+      continue;
+    }
+    const OBJModel &model = entity.getModel();
+    auto sceneModel = sceneModels.find(&model);
+    if (sceneModel == sceneModels.end()) {
+      sceneModel = sceneModels.insert({&model, scene.createModel(model)}).first;
+    }
+    // the model spans -1 to 1 on each axis, and is turned to face theta around the vertical
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), entity.position * BLOCK_SCALE);
+    transform = glm::rotate(transform, entity.theta, glm::vec3(POSY));
+    transform = glm::scale(transform, halfSize * BLOCK_SCALE);
+    scene.addInstance(sceneModel->second, transform);
+  }
+}
+
 void EntityGod::createEntity(Entity entity) {
   glm::ivec3 spawnChunk = World::blockToChunkCoordinate(glm::ivec3(entity.position));
   // TODO: add name check
@@ -566,21 +639,266 @@ float ChunkPerlinNoiseCache3D::sample(glm::ivec3 blockCoordinate) {
   return zi;
 }
 
-ChunkGenerator::ChunkGenerator(glm::ivec3 chunkCoord, int worldSeed, std::vector<NoiseProfile*> noiseProfiles) {
-  chunkCoordinate = chunkCoord;
+// the smoothstep the interpolation weights follow
+float fade(float weight) {
+  return weight * weight * (3.0f - weight * 2.0f);
+}
+
+// bound the noise over a box of cell offsets lying within a single cell
+void ChunkPerlinNoiseCache3D::boxBounds(glm::ivec3 cellOrigin, glm::vec3 boxLo, glm::vec3 boxHi, float &lo, float &hi) const {
+  glm::vec3 center = (boxLo + boxHi) * 0.5f;
+  glm::vec3 extent = (boxHi - boxLo) * 0.5f;
+  // split each dot product into its value at the center of the box plus a deviation
+  // bounded by how far a unit gradient can reach across the box
+  float centerDots[8];
+  float deviation = 0;
+  for (int i = 0; i < 8; i += 1) {
+    glm::ivec3 corner = {i & 1, (i >> 1) & 1, (i >> 2) & 1};
+    glm::vec3 gradient = grid[gridToIndex(cellOrigin + corner)];
+    centerDots[i] = glm::dot(gradient, center - glm::vec3(corner));
+    deviation = std::max(deviation, glm::dot(glm::abs(gradient), extent));
+  }
+  // interpolating fixed values is multilinear in the faded offsets, so its extremes lie on
+  // the corners of the box
+  glm::vec3 fadeLo = {fade(boxLo.x), fade(boxLo.y), fade(boxLo.z)};
+  glm::vec3 fadeHi = {fade(boxHi.x), fade(boxHi.y), fade(boxHi.z)};
+  lo = INFINITY;
+  hi = -INFINITY;
+  for (int j = 0; j < 8; j += 1) {
+    glm::vec3 weight = {j & 1 ? fadeHi.x : fadeLo.x, j & 2 ? fadeHi.y : fadeLo.y, j & 4 ? fadeHi.z : fadeLo.z};
+    float interpolated = 0;
+    for (int i = 0; i < 8; i += 1) {
+      interpolated += centerDots[i]
+        * (i & 1 ? weight.x : 1 - weight.x)
+        * (i & 2 ? weight.y : 1 - weight.y)
+        * (i & 4 ? weight.z : 1 - weight.z);
+    }
+    lo = std::min(lo, interpolated);
+    hi = std::max(hi, interpolated);
+  }
+  lo -= deviation;
+  hi += deviation;
+}
+
+void ChunkPerlinNoiseCache3D::bounds(float &lo, float &hi) const {
+  // blocks are bounded a few at a time, so the boxes stay small relative to the cells
+  const int step = 4;
+  lo = INFINITY;
+  hi = -INFINITY;
+  for (int z = 0; z < CHUNK_SIZE; z += step) {
+    for (int y = 0; y < CHUNK_SIZE; y += step) {
+      for (int x = 0; x < CHUNK_SIZE; x += step) {
+        glm::ivec3 firstBlock = chunkCoordinate * CHUNK_SIZE + glm::ivec3(x, y, z);
+        glm::vec3 first = blockToGridScale(firstBlock);
+        glm::vec3 last = blockToGridScale(firstBlock + step - 1);
+        glm::ivec3 firstCell = glm::ivec3(glm::floor(first));
+        glm::ivec3 lastCell = glm::ivec3(glm::floor(last));
+        for (int cz = firstCell.z; cz <= lastCell.z; cz += 1) {
+          for (int cy = firstCell.y; cy <= lastCell.y; cy += 1) {
+            for (int cx = firstCell.x; cx <= lastCell.x; cx += 1) {
+              glm::ivec3 cellOrigin = {cx, cy, cz};
+              float boxLo, boxHi;
+              boxBounds(
+                cellOrigin,
+                glm::max(first - glm::vec3(cellOrigin), 0.0f),
+                glm::min(last - glm::vec3(cellOrigin), 1.0f),
+                boxLo, boxHi);
+              lo = std::min(lo, boxLo);
+              hi = std::max(hi, boxHi);
+            }
+          }
+        }
+      }
+    }
+  }
+  lo = std::max(lo, -PERLIN_AMPLITUDE);
+  hi = std::min(hi, PERLIN_AMPLITUDE);
+}
+
+void ChunkNoiseSampler::sampleRow(glm::ivec3 firstBlock, float* values) {
+  for (int x = 0; x < CHUNK_SIZE; x += 1) {
+    values[x] = sample(firstBlock + glm::ivec3(x, 0, 0));
+  }
+}
+
+// the 12 gradients simplex noise picks from, the midpoints of a cube's edges, one row per axis
+const float SIMPLEX_GRADIENTS[3][12] = {
+  {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0},
+  {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1},
+  {0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1}
+};
+// factors for skewing space into a grid of cubes, and unskewing back
+const float SIMPLEX_SKEW = 1.0f / 3.0f;
+const float SIMPLEX_UNSKEW = 1.0f / 6.0f;
+
+SimplexNoise3D::SimplexNoise3D(float noiseScale, int worldSeed) {
+  scale = noiseScale;
+  uint8_t shuffled[256];
+  for (int i = 0; i < 256; i += 1) {
+    shuffled[i] = i;
+  }
+  // like the perlin vectors, mix in the scale so octaves don't line up
+  std::mt19937 random(worldSeed ^ int(noiseScale * 7919));
+  std::shuffle(shuffled, shuffled + 256, random);
+  for (int i = 0; i < 512; i += 1) {
+    permutation[i] = shuffled[i & 255];
+  }
+}
+
+inline int SimplexNoise3D::gradientIndex(int i, int j, int k) const {
+  return permutation[(i & 255) + permutation[(j & 255) + permutation[k & 255]]] % 12;
+}
+
+// the contribution of a simplex corner at an offset, which fades to nothing 0.6 units away
+inline float simplexCorner(float x, float y, float z, int gradient) {
+  float t = std::max(0.6f - x * x - y * y - z * z, 0.0f);
+  t *= t;
+  return t * t * (SIMPLEX_GRADIENTS[0][gradient] * x + SIMPLEX_GRADIENTS[1][gradient] * y + SIMPLEX_GRADIENTS[2][gradient] * z);
+}
+
+// written without branches so that rows of samples can be evaluated side by side
+inline float SimplexNoise3D::noise(float x, float y, float z) const {
+  // find the skewed cube holding the point, and the offset from its origin corner
+  float skew = (x + y + z) * SIMPLEX_SKEW;
+  int i = int(std::floor(x + skew));
+  int j = int(std::floor(y + skew));
+  int k = int(std::floor(z + skew));
+  float unskew = (i + j + k) * SIMPLEX_UNSKEW;
+  float x0 = x - (i - unskew);
+  float y0 = y - (j - unskew);
+  float z0 = z - (k - unskew);
+  // the order of the offsets picks which of the cube's six simplices holds the point
+  int i1 = (x0 >= y0) & (x0 >= z0);
+  int j1 = (y0 > x0) & (y0 >= z0);
+  int k1 = (z0 > x0) & (z0 > y0);
+  int i2 = (x0 >= y0) | (x0 >= z0);
+  int j2 = (y0 > x0) | (y0 >= z0);
+  int k2 = !((x0 >= z0) & (y0 >= z0));
+  // offsets from the other three corners of the simplex
+  float x1 = x0 - i1 + SIMPLEX_UNSKEW;
+  float y1 = y0 - j1 + SIMPLEX_UNSKEW;
+  float z1 = z0 - k1 + SIMPLEX_UNSKEW;
+  float x2 = x0 - i2 + 2 * SIMPLEX_UNSKEW;
+  float y2 = y0 - j2 + 2 * SIMPLEX_UNSKEW;
+  float z2 = z0 - k2 + 2 * SIMPLEX_UNSKEW;
+  float x3 = x0 - 1 + 3 * SIMPLEX_UNSKEW;
+  float y3 = y0 - 1 + 3 * SIMPLEX_UNSKEW;
+  float z3 = z0 - 1 + 3 * SIMPLEX_UNSKEW;
+  // scaled so the result roughly spans [-1, 1]
+  return 32.0f * (
+    simplexCorner(x0, y0, z0, gradientIndex(i, j, k))
+    + simplexCorner(x1, y1, z1, gradientIndex(i + i1, j + j1, k + k1))
+    + simplexCorner(x2, y2, z2, gradientIndex(i + i2, j + j2, k + k2))
+    + simplexCorner(x3, y3, z3, gradientIndex(i + 1, j + 1, k + 1)));
+}
+
+float SimplexNoise3D::sample(glm::ivec3 blockCoordinate) {
+  glm::vec3 point = glm::vec3(blockCoordinate) / scale;
+  return noise(point.x, point.y, point.z);
+}
+
+void SimplexNoise3D::sampleRow(glm::ivec3 firstBlock, float* values) {
+  float y = firstBlock.y / scale;
+  float z = firstBlock.z / scale;
+  for (int x = 0; x < CHUNK_SIZE; x += 1) {
+    values[x] = noise((firstBlock.x + x) / scale, y, z);
+  }
+}
+
+void SimplexNoise3D::bounds(float &lo, float &hi) const {
+  lo = -SIMPLEX_AMPLITUDE;
+  hi = SIMPLEX_AMPLITUDE;
+}
+
+bool ChunkGenerator::needsSpawnPlatform() {
+  return false;
+}
+
+NoiseChunkGenerator::NoiseChunkGenerator(int worldSeed, std::vector<NoiseProfile> noiseProfiles) {
   seed = worldSeed;
   noises = noiseProfiles;
+  for (NoiseProfile noise : noises) {
+    worldSamplers.push_back(noise.engine == NOISE_SIMPLEX ? new SimplexNoise3D(noise.scale, seed) : nullptr);
+  }
 }
 
-float ChunkGenerator::sampleCompoundNoise(glm::ivec3 blockCoordinate) {
+NoiseChunkGenerator::~NoiseChunkGenerator() {
+  for (ChunkNoiseSampler* sampler : worldSamplers) {
+    delete sampler;
+  }
+}
+
+bool NoiseChunkGenerator::needsSpawnPlatform() {
+  return true;
+}
+
+void NoiseChunkGenerator::sampleCompoundNoise(std::vector<ChunkNoiseSampler*> &samplers, glm::ivec3 firstBlock, float* values) {
+  float octave[CHUNK_SIZE];
+  std::fill(values, values + CHUNK_SIZE, 0.0f);
+  for (size_t i = 0; i < noises.size(); i += 1) {
+    samplers[i]->sampleRow(firstBlock, octave);
+    for (int x = 0; x < CHUNK_SIZE; x += 1) {
+      values[x] += octave[x] * noises[i].magnitude;
+    }
+  }
+}
+
+float NoiseChunkGenerator::amplitude() {
   float total = 0;
-  for (NoiseProfile* noise : noises) {
-    total += noise->sampler.sample(blockCoordinate) * noise->magnitude;
+  for (NoiseProfile noise : noises) {
+    total += std::abs(noise.magnitude) * (noise.engine == NOISE_SIMPLEX ? SIMPLEX_AMPLITUDE : PERLIN_AMPLITUDE);
   }
   return total;
 }
 
-Chunk ChunkGenerator::generateChunk() {
+float NoiseChunkGenerator::airThreshold(int y) {
+  float airiness = glm::smoothstep(
+    TERRAIN_GROUND_LEVEL - TERRAIN_RUGGEDNESS, TERRAIN_GROUND_LEVEL + TERRAIN_RUGGEDNESS, float(y));
+  // underground will be 50% air, aboveground will be 80% air
+  return -0.1 + airiness * 0.7;
+}
+
+uint8_t NoiseChunkGenerator::classifyBlock(float noiseValue, int y) {
+  float dirtDepth = TERRAIN_GROUND_LEVEL - TERRAIN_RUGGEDNESS;
+  float airThreshold = NoiseChunkGenerator::airThreshold(y);
+  float dirtThreshold = airThreshold + 0.2;
+  if (noiseValue < airThreshold) {
+    return BLOCKTYPE_AIR;
+  } else if (noiseValue >= airThreshold && noiseValue < dirtThreshold && y >= dirtDepth) {
+    return BLOCKTYPE_DIRT;
+  }
+  return BLOCKTYPE_STONE;
+}
+
+// the air threshold only grows with altitude, so the bottom layer of the chunk decides
+bool NoiseChunkGenerator::provablyAir(glm::ivec3 chunkCoordinate, float noiseHi) {
+  return noiseHi < airThreshold(chunkCoordinate.y * CHUNK_SIZE);
+}
+
+// likewise, the top layer of the chunk decides whether it is all stone
+bool NoiseChunkGenerator::provablySolid(glm::ivec3 chunkCoordinate, float noiseLo) {
+  int top = chunkCoordinate.y * CHUNK_SIZE + CHUNK_SIZE - 1;
+  float dirtDepth = TERRAIN_GROUND_LEVEL - TERRAIN_RUGGEDNESS;
+  return noiseLo >= airThreshold(top) && (top < dirtDepth || noiseLo >= airThreshold(top) + 0.2);
+}
+
+Chunk NoiseChunkGenerator::generateChunk(glm::ivec3 chunkCoordinate) {
+  // perlin octaves need their lattice cached around the chunk
+  std::vector<ChunkNoiseSampler*> samplers;
+  for (size_t i = 0; i < noises.size(); i += 1) {
+    ChunkNoiseSampler* worldSampler = worldSamplers[i];
+    samplers.push_back(worldSampler ? worldSampler : new ChunkPerlinNoiseCache3D(noises[i].scale, seed, chunkCoordinate));
+  }
+  Chunk chunk = carveChunk(chunkCoordinate, samplers);
+  for (size_t i = 0; i < noises.size(); i += 1) {
+    if (samplers[i] != worldSamplers[i]) {
+      delete samplers[i];
+    }
+  }
+  return chunk;
+}
+
+Chunk NoiseChunkGenerator::carveChunk(glm::ivec3 chunkCoordinate, std::vector<ChunkNoiseSampler*> &samplers) {
   Chunk chunk;
   // std::cout << "Generating chunk..." << std::endl;
   // TODO:
@@ -602,31 +920,35 @@ Chunk ChunkGenerator::generateChunk() {
   //    structure if there are enough connected chunks to fit it?
   // (idea?) 6. Maybe a better idea - some way to find random points isometrically
   //  - within a certain range
+
+  // chunks far enough from the terrain band are decided by altitude alone. the noise
+  // configuration bounds the band globally, and this chunk's lattice narrows it further
+  float noiseLo = -amplitude();
+  float noiseHi = amplitude();
+  if (!provablyAir(chunkCoordinate, noiseHi) && !provablySolid(chunkCoordinate, noiseLo)) {
+    noiseLo = 0;
+    noiseHi = 0;
+    for (size_t i = 0; i < noises.size(); i += 1) {
+      float lo, hi;
+      samplers[i]->bounds(lo, hi);
+      noiseLo += std::min(lo * noises[i].magnitude, hi * noises[i].magnitude);
+      noiseHi += std::max(lo * noises[i].magnitude, hi * noises[i].magnitude);
+    }
+  }
+  bool air = provablyAir(chunkCoordinate, noiseHi);
+  if (air || provablySolid(chunkCoordinate, noiseLo)) {
+    memset(chunk.blocks, air ? BLOCKTYPE_AIR : BLOCKTYPE_STONE, sizeof(chunk.blocks));
+    return chunk;
+  }
+
+  float values[CHUNK_SIZE];
   for (int z = 0; z < CHUNK_SIZE; z += 1) {
     // std::cout << "layer ------------------------" << std::endl;
     for (int y = 0; y < CHUNK_SIZE; y += 1) {
+      glm::ivec3 firstBlock = glm::ivec3(0, y, z) + chunkCoordinate * CHUNK_SIZE;
+      sampleCompoundNoise(samplers, firstBlock, values);
       for (int x = 0; x < CHUNK_SIZE; x += 1) {
-        glm::ivec3 blockCoordinate = glm::ivec3(x, y, z) + chunkCoordinate * CHUNK_SIZE;
-        float noiseValue = sampleCompoundNoise(blockCoordinate);
-        float seaLevel = -10;
-        float groundLevel = -6;
-        float ruggedNess = 16;
-        float airiness = glm::smoothstep(groundLevel - ruggedNess, groundLevel + ruggedNess, float(blockCoordinate.y));
-        float dirtDepth = groundLevel - ruggedNess;
-        // underground will be 50% air, aboveground will be 80% air
-        float airThreshold = -0.1 + airiness * 0.7;
-        float dirtThreshold = airThreshold + 0.2;
-        uint8_t blockType;
-        if (noiseValue < airThreshold) {
-          // std::cout << "  ";
-          blockType = BLOCKTYPE_AIR;
-        } else if (noiseValue >= airThreshold && noiseValue < dirtThreshold && blockCoordinate.y >= dirtDepth) {
-          // std::cout << "░░";
-          blockType = BLOCKTYPE_DIRT;
-        } else {
-          blockType = BLOCKTYPE_STONE;
-        }
-        chunk.blocks[z][y][x] = blockType;
+        chunk.blocks[z][y][x] = classifyBlock(values[x], firstBlock.y);
       }
       // std::cout << std::endl;
     }
@@ -634,7 +956,77 @@ Chunk ChunkGenerator::generateChunk() {
   return chunk;
 }
 
-TerrainGod::TerrainGod(World &world): God(world) {}
+Chunk SuperflatChunkGenerator::generateChunk(glm::ivec3 chunkCoordinate) {
+  Chunk chunk;
+  for (int y = 0; y < CHUNK_SIZE; y += 1) {
+    int blockY = chunkCoordinate.y * CHUNK_SIZE + y;
+    uint8_t blockType = BLOCKTYPE_AIR;
+    if (blockY == -1) {
+      blockType = BLOCKTYPE_GRASS;
+    } else if (blockY < -1 && blockY >= -4) {
+      blockType = BLOCKTYPE_DIRT;
+    } else if (blockY < -4) {
+      blockType = BLOCKTYPE_STONE;
+    }
+    for (int z = 0; z < CHUNK_SIZE; z += 1) {
+      memset(chunk.blocks[z][y], blockType, CHUNK_SIZE);
+    }
+  }
+  return chunk;
+}
+
+Chunk CheckerboardChunkGenerator::generateChunk(glm::ivec3 chunkCoordinate) {
+  Chunk chunk;
+  for (int z = 0; z < CHUNK_SIZE; z += 1) {
+    for (int y = 0; y < CHUNK_SIZE; y += 1) {
+      for (int x = 0; x < CHUNK_SIZE; x += 1) {
+        glm::ivec3 blockCoordinate = glm::ivec3(x, y, z) + chunkCoordinate * CHUNK_SIZE;
+        bool solid = blockCoordinate.y < 0 && (x + y + z) % 2 == 0;
+        chunk.blocks[z][y][x] = solid ? BLOCKTYPE_STONE : BLOCKTYPE_AIR;
+      }
+    }
+  }
+  return chunk;
+}
+
+UniformChunkGenerator::UniformChunkGenerator(uint8_t type) {
+  blockType = type;
+}
+
+Chunk UniformChunkGenerator::generateChunk(glm::ivec3) {
+  Chunk chunk;
+  memset(chunk.blocks, blockType, sizeof(chunk.blocks));
+  return chunk;
+}
+
+// the generators selectable at startup, by name
+const std::map<std::string, ChunkGenerator* (*)(int)> CHUNK_GENERATORS = {
+  {"noise", [](int seed) -> ChunkGenerator* { return new NoiseChunkGenerator(seed, {{40, 0.7f}, {9, 0.3f}}); }},
+  {"simplex", [](int seed) -> ChunkGenerator* {
+    return new NoiseChunkGenerator(seed, {{40, 0.7f, NOISE_SIMPLEX}, {9, 0.3f, NOISE_SIMPLEX}});
+  }},
+  {"superflat", [](int) -> ChunkGenerator* { return new SuperflatChunkGenerator(); }},
+  {"checkerboard", [](int) -> ChunkGenerator* { return new CheckerboardChunkGenerator(); }},
+  {"solid", [](int) -> ChunkGenerator* { return new UniformChunkGenerator(BLOCKTYPE_STONE); }},
+  {"air", [](int) -> ChunkGenerator* { return new UniformChunkGenerator(BLOCKTYPE_AIR); }}
+};
+
+ChunkGenerator* createChunkGenerator(std::string name, int worldSeed) {
+  if (CHUNK_GENERATORS.find(name) == CHUNK_GENERATORS.end()) {
+    return nullptr;
+  }
+  return CHUNK_GENERATORS.at(name)(worldSeed);
+}
+
+std::vector<std::string> chunkGeneratorNames() {
+  std::vector<std::string> names;
+  for (auto entry : CHUNK_GENERATORS) {
+    names.push_back(entry.first);
+  }
+  return names;
+}
+
+TerrainGod::TerrainGod(World &world, ChunkGenerator &chunkGenerator): God(world), generator(chunkGenerator) {}
 
 void TerrainGod::update() {
   std::unordered_map<glm::ivec3, glm::vec3> grid;
@@ -649,25 +1041,19 @@ void TerrainGod::update() {
           continue;
         }
         world.divineIntervention.lock();
-        if (!world.hasChunk(chunkCoordinate)) {
-          world.divineIntervention.unlock();
+        bool generated = world.hasChunk(chunkCoordinate);
+        world.divineIntervention.unlock();
+        // generateChunk takes the lock again only to store the chunk
+        if (!generated) {
           generateChunk(chunkCoordinate, grid);
         }
-        world.divineIntervention.unlock();
       }
     }
   }
 }
 
 void TerrainGod::generateChunk(glm::ivec3 chunkCoordinate, std::unordered_map<glm::ivec3, glm::vec3> &grid) {
-  ChunkPerlinNoiseCache3D cache1 = ChunkPerlinNoiseCache3D(40, world.seed, chunkCoordinate);
-  ChunkPerlinNoiseCache3D cache2 = ChunkPerlinNoiseCache3D(9, world.seed, chunkCoordinate);
-  glm::ivec3 d = cache1.corner2 - cache1.corner1;
-
-  NoiseProfile noise1 = {0.7f, cache1};
-  NoiseProfile noise2 = {0.3f, cache2};
-  std::vector<NoiseProfile*> noises{&noise1, &noise2};
-  Chunk chunk = ChunkGenerator(chunkCoordinate, world.seed, noises).generateChunk();
+  Chunk chunk = generator.generateChunk(chunkCoordinate);
   
   world.divineIntervention.lock();
   world.setChunk(chunkCoordinate, chunk);
@@ -675,6 +1061,11 @@ void TerrainGod::generateChunk(glm::ivec3 chunkCoordinate, std::unordered_map<gl
 }
 
 void TerrainGod::generateSpawn() {
+  update();
+  // only noise terrain needs a guaranteed place to stand
+  if (!generator.needsSpawnPlatform()) {
+    return;
+  }
   Chunk chunk = {{{0}}};
   chunk.blocks[5][14][5] = BLOCKTYPE_LEAVES;
   for (int z = 0; z < CHUNK_SIZE; z += 1) {
@@ -683,7 +1074,6 @@ void TerrainGod::generateSpawn() {
       chunk.blocks[z][y][x] = BLOCKTYPE_BRICK;
     }
   }
-  update();
   
         // std::cout << "lock 4" << std::endl;
   world.divineIntervention.lock();
@@ -698,86 +1088,731 @@ void TerrainGod::generateSpawn() {
 */
 
 
-// calculate a list of faces generated selectively based on air-exposed blocks
-std::vector<RenderBlockFace> calculateChunkFaces(Chunk &chunk) {
-  std::vector<RenderBlockFace> faces;
-  // iterate through all blocks in the chunk
+// the axes that the columns and rows of ChunkFaceMasks run along for each of ORTHO_DIRS
+const glm::ivec3 FACE_MASK_COLUMNS[6] = {POSY, POSY, POSX, POSX, POSX, POSX};
+const glm::ivec3 FACE_MASK_ROWS[6] = {POSZ, POSZ, POSZ, POSZ, POSY, POSY};
+
+RenderPass blockRenderPass(uint8_t blockType) {
+  switch (blockType) {
+    case BLOCKTYPE_LEAVES:
+      return PASS_CUTOUT;
+    case BLOCKTYPE_WATER:
+      return PASS_TRANSLUCENT;
+    default:
+      return PASS_OPAQUE;
+  }
+}
+
+std::array<bool, 256> buildOpaqueBlocks() {
+  std::array<bool, 256> opaque;
+  for (int type = 0; type < 256; type += 1) {
+    opaque[type] = type != BLOCKTYPE_AIR && blockRenderPass(type) == PASS_OPAQUE;
+  }
+  return opaque;
+}
+
+// whether each block type hides the faces behind it, looked up for every block when meshing
+const std::array<bool, 256> OPAQUE_BLOCKS = buildOpaqueBlocks();
+
+bool opaqueBlock(uint8_t blockType) {
+  return OPAQUE_BLOCKS[blockType];
+}
+
+// the block at a local coordinate up to one block outside the chunk, reaching into the
+// neighboring chunk on that side, where missing neighbors count as air
+uint8_t neighborhoodBlock(Chunk &chunk, Chunk* neighbors[6], glm::ivec3 localBlockCoordinate) {
+  if (Chunk::inBounds(localBlockCoordinate)) {
+    return chunk.getBlock(localBlockCoordinate);
+  }
+  for (int d = 0; d < 6; d += 1) {
+    glm::ivec3 inside = localBlockCoordinate - ORTHO_DIRS[d] * CHUNK_SIZE;
+    if (Chunk::inBounds(inside)) {
+      return neighbors[d] != nullptr ? neighbors[d]->getBlock(inside) : BLOCKTYPE_AIR;
+    }
+  }
+  return BLOCKTYPE_AIR;
+}
+
+// whether a block's face is drawn. faces hide behind opaque blocks, and between see-through
+// blocks of the same type, so the inside of a body of water or a tree's leaves has no faces
+bool faceExposed(Chunk &chunk, Chunk* neighbors[6], glm::ivec3 localBlockCoordinate, int d) {
+  uint8_t type = chunk.getBlock(localBlockCoordinate);
+  uint8_t neighbor = neighborhoodBlock(chunk, neighbors, localBlockCoordinate + ORTHO_DIRS[d]);
+  return type != BLOCKTYPE_AIR && !opaqueBlock(neighbor) && neighbor != type;
+}
+
+// set whether the face of a block pointing along ORTHO_DIRS[d] is exposed
+void setFaceMask(ChunkFaceMasks &masks, glm::ivec3 localBlockCoordinate, int d, bool exposed) {
+  glm::ivec3 b = localBlockCoordinate;
+  int depth = axisValue(b * glm::abs(ORTHO_DIRS[d]));
+  int row = axisValue(b * FACE_MASK_ROWS[d]);
+  int column = axisValue(b * FACE_MASK_COLUMNS[d]);
+  uint16_t bit = 1 << column;
+  masks[d][depth][row] = exposed ? masks[d][depth][row] | bit : masks[d][depth][row] & ~bit;
+}
+
+// a row of blocks along x as a bitmask, with bit x + 1 set for opaque blocks
+uint32_t opaqueRow(const uint8_t row[CHUNK_SIZE]) {
+  uint32_t mask = 0;
+  for (int x = 0; x < CHUNK_SIZE; x += 1) {
+    mask |= uint32_t(opaqueBlock(row[x])) << (x + 1);
+  }
+  return mask;
+}
+
+// find the exposed faces of a chunk a whole row of blocks at a time.
+// neighbors are the adjacent chunks in the order of ORTHO_DIRS, with nullptr counting as air
+void calculateChunkFaceMasks(Chunk &chunk, Chunk* neighbors[6], ChunkFaceMasks &masks) {
+  // opaque blocks by z then y, with one bit per x. the border holds the neighboring chunks'
+  // adjacent blocks, so the x bits run from -1 to CHUNK_SIZE and the rows from -1 to CHUNK_SIZE
+  uint32_t opaque[CHUNK_SIZE + 2][CHUNK_SIZE + 2] = {};
+  // the chunk's own solid blocks, in the same layout without the border
+  uint32_t solid[CHUNK_SIZE][CHUNK_SIZE];
+  // whether any solid block lets light through, so some faces need a closer look
+  bool seeThrough = false;
+  const int last = CHUNK_SIZE - 1;
   for (int z = 0; z < CHUNK_SIZE; z += 1) {
     for (int y = 0; y < CHUNK_SIZE; y += 1) {
+      uint32_t row = 0;
+      solid[z][y] = 0;
       for (int x = 0; x < CHUNK_SIZE; x += 1) {
-        // for a given block coordinate
-        glm::ivec3 blockCoordinate = {x, y, z};
-        // if it is air, no faces needed
-        if (chunk.getBlock(blockCoordinate) == BLOCKTYPE_AIR) {
-          continue;
+        uint8_t type = chunk.blocks[z][y][x];
+        solid[z][y] |= uint32_t(type != BLOCKTYPE_AIR) << (x + 1);
+        row |= uint32_t(OPAQUE_BLOCKS[type]) << (x + 1);
+      }
+      seeThrough |= solid[z][y] != row;
+      if (neighbors[0] != nullptr) {
+        row |= uint32_t(opaqueBlock(neighbors[0]->blocks[z][y][0])) << (CHUNK_SIZE + 1);
+      }
+      if (neighbors[1] != nullptr) {
+        row |= uint32_t(opaqueBlock(neighbors[1]->blocks[z][y][last]));
+      }
+      opaque[z + 1][y + 1] = row;
+    }
+  }
+  for (int i = 0; i < CHUNK_SIZE; i += 1) {
+    opaque[i + 1][CHUNK_SIZE + 1] = neighbors[2] != nullptr ? opaqueRow(neighbors[2]->blocks[i][0]) : 0;
+    opaque[i + 1][0] = neighbors[3] != nullptr ? opaqueRow(neighbors[3]->blocks[i][last]) : 0;
+    opaque[CHUNK_SIZE + 1][i + 1] = neighbors[4] != nullptr ? opaqueRow(neighbors[4]->blocks[0][i]) : 0;
+    opaque[0][i + 1] = neighbors[5] != nullptr ? opaqueRow(neighbors[5]->blocks[last][i]) : 0;
+  }
+
+  memset(masks, 0, sizeof(ChunkFaceMasks));
+  for (int z = 0; z < CHUNK_SIZE; z += 1) {
+    for (int y = 0; y < CHUNK_SIZE; y += 1) {
+      uint32_t row = solid[z][y];
+      uint32_t opaqueBeside = opaque[z + 1][y + 1];
+      // x faces come from shifting the row against itself, the others from the rows beside it
+      masks[2][y][z] = (row & ~opaque[z + 1][y + 2]) >> 1;
+      masks[3][y][z] = (row & ~opaque[z + 1][y]) >> 1;
+      masks[4][z][y] = (row & ~opaque[z + 2][y + 1]) >> 1;
+      masks[5][z][y] = (row & ~opaque[z][y + 1]) >> 1;
+      // x faces lie across the rows, so they are transposed one exposed face at a time
+      uint32_t exposed[2] = {(row & ~(opaqueBeside >> 1)) >> 1, (row & ~(opaqueBeside << 1)) >> 1};
+      for (int d = 0; d < 2; d += 1) {
+        for (uint32_t bits = exposed[d] & 0xFFFF; bits != 0; bits &= bits - 1) {
+          masks[d][__builtin_ctz(bits)][z] |= 1 << y;
         }
-        // if it is solid, then add faces for each of the air-facing sides
-        for (glm::ivec3 direction : ORTHO_DIRS) {
-          // don't add a face if the adjacent block is out of bounds or it is not air
-          glm::ivec3 neighbor = blockCoordinate + direction;
-          if (Chunk::inBounds(neighbor) && chunk.getBlock(neighbor) != BLOCKTYPE_AIR) {
-            continue;
+      }
+    }
+  }
+  if (!seeThrough) {
+    return;
+  }
+  // see-through blocks also hide their faces against blocks of their own type
+  for (int z = 0; z < CHUNK_SIZE; z += 1) {
+    for (int y = 0; y < CHUNK_SIZE; y += 1) {
+      uint32_t bits = (solid[z][y] & ~opaque[z + 1][y + 1]) >> 1;
+      for (; bits != 0; bits &= bits - 1) {
+        glm::ivec3 b = {__builtin_ctz(bits), y, z};
+        for (int d = 0; d < 6; d += 1) {
+          if (!faceExposed(chunk, neighbors, b, d)) {
+            setFaceMask(masks, b, d, false);
           }
-          // add the face represented by a block coordinate and a direction
-          faces.push_back({blockCoordinate, direction, chunk.getBlock(blockCoordinate)});
         }
       }
     }
   }
-  return faces;
 }
 
-// TODO: instead of dynamically calculating face vertices, pull from a set of constants
-// for each side for speed
-
-// add the vertices for a given face to a vector
-void addFaceVertices(OBJBuilder &builder, RenderBlockFace face) {
-  glm::vec3 origin = glm::vec3(face.blockCoordinate);
-  std::vector<glm::vec3> vertices(6);
-  std::vector<glm::vec3> normals(6);
-  std::vector<glm::vec2> textureCoordinates(6);
-  glm::vec2 blockTextureOffset = float(face.blockType - 1) * glm::vec2(1.0f, 0.0f);
+// the index of a direction in ORTHO_DIRS
+int directionIndex(glm::ivec3 direction) {
+  for (int i = 0; i < 6; i += 1) {
+    if (ORTHO_DIRS[i] == direction) {
+      return i;
+    }
+  }
+  return -1;
+}
 
-  int vertexDirection = -(face.facing.x | face.facing.y | face.facing.z);
+// merge the exposed faces in one slice of a chunk that share a block type into maximal
+// rectangles. rows are the slice's face masks, which get consumed
+void mergeSliceFaces(Chunk &chunk, int d, int depth, uint16_t rows[CHUNK_SIZE], std::vector<RenderBlockFace> &merged) {
+  glm::ivec3 facing = ORTHO_DIRS[d];
   glm::ivec3 axis1, axis2;
-  otherAxes(face.facing, axis1, axis2);
-  // std::cout << "zeroes: " << zero1 << ", " << zero2 << " verdir: " << vertexDirection << std::endl;
-  glm::vec3 corner = {face.facing.x, face.facing.y, face.facing.z};
-  // iterate through 3 indices
-  for (int i = vertexDirection < 0 ? 2 : 0, _i = 0; _i < 3; i += vertexDirection, _i += 1) {
-    glm::ivec2 offset1 = SQUARE_OFFSETS[TRI1[i % 3]];
-    glm::ivec2 offset2 = SQUARE_OFFSETS[TRI2[i % 3]];
-    glm::vec3 corner1 = glm::vec3(face.facing + axis1 * offset1.x + axis2 * offset1.y);
-    vertices[_i] = origin + 0.5f * corner1;
-    //normals[_i] = glm::normalize(corner1);
-    normals[_i] = face.facing;
-    textureCoordinates[_i] = (blockTextureOffset + (glm::vec2(offset1) + 1.0f) * 0.5f) * .03125f;
-
-    glm::vec3 corner2 = glm::vec3(face.facing + axis1 * offset2.x + axis2 * offset2.y);
-    vertices[_i + 3] = origin + 0.5f * corner2;
-    //normals[_i + 3] = glm::normalize(corner2);
-    normals[_i + 3] = face.facing;
-    textureCoordinates[_i + 3] = (blockTextureOffset + (glm::vec2(offset2) + 1.0f) * 0.5f) * .03125f;
-  }
-  builder.addSimpleFace(vertices, normals, textureCoordinates);
-}
-
-// TODO: optimize chunk rendering and caching by using an intermediate representation of faces that
-// can be more granularly updates with changes to the chunk
-OBJModel Chunk::calculateChunkOBJ() {
-  OBJBuilder builder;
-  for (RenderBlockFace face : calculateChunkFaces(*this)) {
-    addFaceVertices(builder, face);
-  }
-  return builder.model;
-}
-
-RenderGod::RenderGod(World &world, Scene &openGLScene): God(world), scene(openGLScene) {
+  otherAxes(facing, axis1, axis2);
+  glm::ivec3 columnAxis = FACE_MASK_COLUMNS[d];
+  glm::ivec3 rowAxis = FACE_MASK_ROWS[d];
+  glm::ivec3 sliceOrigin = depth * glm::abs(facing);
+  auto blockType = [&](int column, int row) {
+    return chunk.getBlock(sliceOrigin + column * columnAxis + row * rowAxis);
+  };
+  for (int row = 0; row < CHUNK_SIZE; row += 1) {
+    while (rows[row] != 0) {
+      int column = __builtin_ctz(rows[row]);
+      uint8_t type = blockType(column, row);
+      // widen along the row as far as exposed faces of the type continue
+      int width = 1;
+      while (column + width < CHUNK_SIZE && (rows[row] >> (column + width) & 1)
+        && blockType(column + width, row) == type) {
+        width += 1;
+      }
+      uint16_t span = ((1 << width) - 1) << column;
+      // then grow across the rows while the whole span matches
+      auto rowMatches = [&](int next) {
+        if ((rows[next] & span) != span) {
+          return false;
+        }
+        for (int c = column; c < column + width; c += 1) {
+          if (blockType(c, next) != type) {
+            return false;
+          }
+        }
+        return true;
+      };
+      int height = 1;
+      while (row + height < CHUNK_SIZE && rowMatches(row + height)) {
+        height += 1;
+      }
+      for (int r = row; r < row + height; r += 1) {
+        rows[r] &= ~span;
+      }
+      glm::ivec3 blockCoordinate = sliceOrigin + column * columnAxis + row * rowAxis;
+      // the size runs along the face's own axes, which may be the other way around
+      glm::ivec2 size = columnAxis == axis1 ? glm::ivec2(width, height) : glm::ivec2(height, width);
+      merged.push_back({blockCoordinate, facing, type, size});
+    }
+  }
+}
+
+// each cube of the coarse chunk is solid when at least half of its blocks are, taking the type
+// most of its solid blocks share, so thin surfaces don't open holes in distant terrain
+Chunk Chunk::downsample(int level) {
+  Chunk coarse;
+  int step = 1 << level;
+  int volume = step * step * step;
+  int counts[256] = {};
+  for (int cz = 0; cz < CHUNK_SIZE; cz += step) {
+    for (int cy = 0; cy < CHUNK_SIZE; cy += step) {
+      for (int cx = 0; cx < CHUNK_SIZE; cx += step) {
+        int solid = 0;
+        uint8_t type = BLOCKTYPE_AIR;
+        for (int z = cz; z < cz + step; z += 1) {
+          for (int y = cy; y < cy + step; y += 1) {
+            for (int x = cx; x < cx + step; x += 1) {
+              uint8_t blockType = blocks[z][y][x];
+              if (blockType == BLOCKTYPE_AIR) {
+                continue;
+              }
+              solid += 1;
+              counts[blockType] += 1;
+              if (type == BLOCKTYPE_AIR || counts[blockType] > counts[type]) {
+                type = blockType;
+              }
+            }
+          }
+        }
+        // only the counted types need resetting for the next cube
+        for (int z = cz; z < cz + step; z += 1) {
+          for (int y = cy; y < cy + step; y += 1) {
+            for (int x = cx; x < cx + step; x += 1) {
+              counts[blocks[z][y][x]] = 0;
+            }
+          }
+        }
+        if (solid * 2 < volume) {
+          type = BLOCKTYPE_AIR;
+        }
+        for (int z = cz; z < cz + step; z += 1) {
+          for (int y = cy; y < cy + step; y += 1) {
+            memset(&coarse.blocks[z][y][cx], type, step);
+          }
+        }
+      }
+    }
+  }
+  return coarse;
+}
+
+// the corners of a block face pointing along one of ORTHO_DIRS, as block corner offsets
+struct FaceCorners {
+  // the corner with the lowest coordinates along axis1 and axis2
+  glm::ivec3 origin;
+  // the axes a merged face stretches along, as in otherAxes
+  glm::ivec3 axis1;
+  glm::ivec3 axis2;
+  // the order to emit the corners in, as indices into SQUARE_OFFSETS, such that TRI1 and TRI2
+  // over the emitted corners wind counterclockwise when seen from the side the face points to
+  int order[4];
+};
+
+std::array<FaceCorners, 6> buildFaceCorners() {
+  std::array<FaceCorners, 6> tables;
+  for (int d = 0; d < 6; d += 1) {
+    glm::ivec3 facing = ORTHO_DIRS[d];
+    glm::ivec3 axis1, axis2;
+    otherAxes(facing, axis1, axis2);
+    FaceCorners &corners = tables[d];
+    // a block's corners sit half a block off its center, so positive faces lie one corner out
+    corners.origin = glm::max(facing, glm::ivec3(0));
+    corners.axis1 = axis1;
+    corners.axis2 = axis2;
+    // faces pointing along the positive axes swap the middle corners to flip the winding
+    bool positive = (facing.x | facing.y | facing.z) > 0;
+    int order[4] = {0, positive ? 2 : 1, positive ? 1 : 2, 3};
+    std::copy(order, order + 4, corners.order);
+  }
+  return tables;
+}
+
+const std::array<FaceCorners, 6> FACE_CORNERS = buildFaceCorners();
+
+// append the corners of a merged face as packed chunk vertices
+void addFaceVertices(std::vector<ChunkVertex> &vertices, const RenderBlockFace &face) {
+  int d = directionIndex(face.facing);
+  const FaceCorners &corners = FACE_CORNERS[d];
+  glm::ivec3 origin = face.blockCoordinate + corners.origin;
+  for (int corner : corners.order) {
+    glm::ivec2 offset = SQUARE_OFFSETS[corner];
+    // the far edges of merged faces lie size blocks further out
+    glm::ivec3 position = origin
+      + (offset.x < 0 ? 0 : face.size.x) * corners.axis1
+      + (offset.y < 0 ? 0 : face.size.y) * corners.axis2;
+    vertices.push_back(ChunkVertex(position, d, face.blockType, corner));
+  }
+}
+
+void ChunkFaceTable::build(Chunk &chunk, Chunk* neighbors[6]) {
+  calculateChunkFaceMasks(chunk, neighbors, masks);
+  std::fill(&dirty[0][0], &dirty[0][0] + 6 * CHUNK_SIZE, true);
+}
+
+void ChunkFaceTable::build(const ChunkFaceMasks &faces) {
+  memcpy(masks, faces, sizeof(masks));
+  std::fill(&dirty[0][0], &dirty[0][0] + 6 * CHUNK_SIZE, true);
+}
+
+const ChunkFaceMasks& ChunkFaceTable::getMasks() {
+  return masks;
+}
+
+void ChunkFaceTable::updateBlock(Chunk &chunk, Chunk* neighbors[6], glm::ivec3 localBlockCoordinate) {
+  glm::ivec3 b = localBlockCoordinate;
+  for (int d = 0; d < 6; d += 1) {
+    setFaceMask(masks, b, d, faceExposed(chunk, neighbors, b, d));
+    // the block's type may have changed too, so its slices merge again either way
+    int depth = axisValue(b * glm::abs(ORTHO_DIRS[d]));
+    dirty[d][depth] = true;
+  }
+}
+
+size_t ChunkFaceTable::writeMesh(Chunk &chunk, glm::ivec3 chunkCoordinate, RenderCache &mesh) {
+  static thread_local std::vector<RenderBlockFace> faces;
+  bool merged[6][CHUNK_SIZE];
+  for (int d = 0; d < 6; d += 1) {
+    for (int depth = 0; depth < CHUNK_SIZE; depth += 1) {
+      merged[d][depth] = dirty[d][depth];
+      if (!dirty[d][depth]) {
+        continue;
+      }
+      uint16_t rows[CHUNK_SIZE];
+      memcpy(rows, masks[d][depth], sizeof(rows));
+      faces.clear();
+      mergeSliceFaces(chunk, d, depth, rows, faces);
+      for (int pass = 0; pass < RENDER_PASSES; pass += 1) {
+        slices[pass][d][depth].clear();
+      }
+      for (RenderBlockFace &face : faces) {
+        addFaceVertices(slices[blockRenderPass(face.blockType)][d][depth], face);
+      }
+      dirty[d][depth] = false;
+    }
+  }
+  size_t vertexCount = 0;
+  size_t firstChanged = SIZE_MAX;
+  for (int pass = 0; pass < RENDER_PASSES; pass += 1) {
+    for (int d = 0; d < 6; d += 1) {
+      size_t faceStart = vertexCount;
+      for (int depth = 0; depth < CHUNK_SIZE; depth += 1) {
+        if (merged[d][depth]) {
+          firstChanged = std::min(firstChanged, vertexCount);
+        }
+        vertexCount += slices[pass][d][depth].size();
+      }
+      mesh.faceVertices[pass][d] = vertexCount - faceStart;
+    }
+  }
+  mesh.texture = "media/textures.ppm";
+  mesh.tiled = true;
+  mesh.origin = glm::vec3(chunkCoordinate * CHUNK_SIZE);
+  mesh.chunkVertices.clear();
+  mesh.chunkVertices.reserve(vertexCount);
+  for (int pass = 0; pass < RENDER_PASSES; pass += 1) {
+    for (int d = 0; d < 6; d += 1) {
+      for (int depth = 0; depth < CHUNK_SIZE; depth += 1) {
+        std::vector<ChunkVertex> &slice = slices[pass][d][depth];
+        mesh.chunkVertices.insert(mesh.chunkVertices.end(), slice.begin(), slice.end());
+      }
+    }
+  }
+  // every quad uses the same index pattern, which the scene's shared quad indices cover
+  mesh.indices.clear();
+  return std::min(firstChanged, vertexCount);
+}
+
+void Chunk::calculateChunkMesh(glm::ivec3 chunkCoordinate, Chunk* neighbors[6], RenderCache &mesh) {
+  // each thread keeps one table, whose slices hold on to their buffers between chunks
+  static thread_local ChunkFaceTable table;
+  table.build(*this, neighbors);
+  table.writeMesh(*this, chunkCoordinate, mesh);
+}
+
+ChunkConnections Chunk::calculateConnections() {
+  // the open blocks of each row along x as bits, flooded a whole run of them at a time
+  uint32_t open[CHUNK_SIZE][CHUNK_SIZE];
+  uint32_t visited[CHUNK_SIZE][CHUNK_SIZE] = {};
+  const uint32_t fullRow = (1u << CHUNK_SIZE) - 1;
+  int openRows = 0;
+  int solidRows = 0;
+  // the open blocks on each face, which is solid when it has none
+  uint32_t anyOpen = 0;
+  uint32_t openFaces[6] = {};
+  for (int z = 0; z < CHUNK_SIZE; z += 1) {
+    for (int y = 0; y < CHUNK_SIZE; y += 1) {
+      uint32_t row = 0;
+      for (int x = 0; x < CHUNK_SIZE; x += 1) {
+        row |= uint32_t(!opaqueBlock(blocks[z][y][x])) << x;
+      }
+      open[z][y] = row;
+      openRows += row == fullRow;
+      solidRows += row == 0;
+      anyOpen |= row;
+      openFaces[2] |= y == CHUNK_SIZE - 1 ? row : 0;
+      openFaces[3] |= y == 0 ? row : 0;
+      openFaces[4] |= z == CHUNK_SIZE - 1 ? row : 0;
+      openFaces[5] |= z == 0 ? row : 0;
+    }
+  }
+  if (solidRows == CHUNK_SIZE * CHUNK_SIZE) {
+    return ALL_FACES_SOLID;
+  }
+  if (openRows == CHUNK_SIZE * CHUNK_SIZE) {
+    return ALL_FACES_CONNECTED;
+  }
+  openFaces[0] = anyOpen >> (CHUNK_SIZE - 1) & 1;
+  openFaces[1] = anyOpen & 1;
+  ChunkConnections connections = 0;
+  for (int d = 0; d < 6; d += 1) {
+    if (openFaces[d] == 0) {
+      connections |= 1ull << (SOLID_FACE_BIT + d);
+    }
+  }
+  // rows with open blocks still to flood from, as bits
+  struct Seeds {
+    int y, z;
+    uint32_t bits;
+  };
+  // kept by each thread, so its buffer gets reused
+  static thread_local std::vector<Seeds> stack;
+  for (int z = 0; z < CHUNK_SIZE; z += 1) {
+    for (int y = 0; y < CHUNK_SIZE; y += 1) {
+      uint32_t unvisited;
+      while ((unvisited = open[z][y] & ~visited[z][y]) != 0) {
+        // flood the pocket holding the first unvisited block, noting the faces of the chunk it
+        // touches. the positive direction of each axis comes first
+        uint8_t faces = 0;
+        stack.push_back({y, z, unvisited & (~unvisited + 1)});
+        while (!stack.empty()) {
+          Seeds seeds = stack.back();
+          stack.pop_back();
+          uint32_t row = open[seeds.z][seeds.y];
+          uint32_t pending = seeds.bits & ~visited[seeds.z][seeds.y];
+          while (pending != 0) {
+            // grow the lowest pending block into the run of open blocks around it
+            uint32_t run = pending & (~pending + 1);
+            for (uint32_t grown = (run | run << 1 | run >> 1) & row; grown != run; grown = (run | run << 1 | run >> 1) & row) {
+              run = grown;
+            }
+            visited[seeds.z][seeds.y] |= run;
+            pending &= ~run;
+            faces |= (run >> (CHUNK_SIZE - 1) & 1) | (run & 1) << 1;
+            faces |= (seeds.y == CHUNK_SIZE - 1) << 2 | (seeds.y == 0) << 3;
+            faces |= (seeds.z == CHUNK_SIZE - 1) << 4 | (seeds.z == 0) << 5;
+            const int nextRows[4][2] = {{seeds.y + 1, seeds.z}, {seeds.y - 1, seeds.z}, {seeds.y, seeds.z + 1}, {seeds.y, seeds.z - 1}};
+            for (const int *next : nextRows) {
+              if (next[0] < 0 || next[0] >= CHUNK_SIZE || next[1] < 0 || next[1] >= CHUNK_SIZE) {
+                continue;
+              }
+              uint32_t reached = run & open[next[1]][next[0]] & ~visited[next[1]][next[0]];
+              if (reached != 0) {
+                stack.push_back({next[0], next[1], reached});
+              }
+            }
+          }
+        }
+        for (int d = 0; d < 6; d += 1) {
+          if (faces >> d & 1) {
+            connections |= ChunkConnections(faces) << (d * 6);
+          }
+        }
+      }
+    }
+  }
+  return connections;
+}
+
+int ChunkPathSearch::cell(glm::ivec3 chunkCoordinate) const {
+  glm::ivec3 offset = chunkCoordinate - gridCorner;
+  if (glm::any(glm::lessThan(offset, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(offset, glm::ivec3(gridSide)))) {
+    return -1;
+  }
+  return (offset.z * gridSide + offset.y) * gridSide + offset.x;
+}
+
+void ChunkPathSearch::search(const std::unordered_map<glm::ivec3, ChunkConnections> &connections, glm::ivec3 eyeChunk, glm::ivec3 center, float maxDistance) {
+  // the cube leaves a ring of cells out of reach around the sphere, so steps never leave it
+  int reach = int(maxDistance) + 1;
+  gridCorner = center - reach;
+  gridSide = reach * 2 + 1;
+  size_t cells = size_t(gridSide) * gridSide * gridSide;
+  gridConnections.assign(cells, ALL_FACES_CONNECTED);
+  enteredFaces.resize(cells);
+  for (int z = 0; z < gridSide; z += 1) {
+    for (int y = 0; y < gridSide; y += 1) {
+      for (int x = 0; x < gridSide; x += 1) {
+        glm::vec3 offset = glm::vec3(x, y, z) - float(reach);
+        enteredFaces[(z * gridSide + y) * gridSide + x] = glm::length(offset) > maxDistance ? OUT_OF_REACH : 0;
+      }
+    }
+  }
+  steps.clear();
+  int eyeCell = cell(eyeChunk);
+  searched = eyeCell >= 0 && enteredFaces[eyeCell] != OUT_OF_REACH;
+  if (!searched) {
+    return;
+  }
+  for (auto &entry : connections) {
+    int i = cell(entry.first);
+    if (i >= 0) {
+      gridConnections[i] = entry.second;
+    }
+  }
+  // how far apart the cells of neighbors along ORTHO_DIRS are
+  const int strides[6] = {1, -1, gridSide, -gridSide, gridSide * gridSide, -gridSide * gridSide};
+  // breadth first through the faces each chunk connects. the eye could be anywhere in its
+  // own chunk, so every face of that one is open
+  enteredFaces[eyeCell] = 0x3F;
+  steps.push_back({eyeCell, -1, 0});
+  for (size_t i = 0; i < steps.size(); i += 1) {
+    PathStep step = steps[i];
+    ChunkConnections open = step.face < 0 ? ALL_FACES_CONNECTED : gridConnections[step.cell];
+    for (int d = 0; d < 6; d += 1) {
+      // paths never turn back along a direction they already moved in, which keeps them
+      // heading away from the eye. d ^ 1 is the opposite of d
+      if ((step.directions >> (d ^ 1) & 1) || (step.face >= 0 && !facesConnect(open, step.face, d))) {
+        continue;
+      }
+      int next = step.cell + strides[d];
+      if (enteredFaces[next] & (OUT_OF_REACH | 1 << (d ^ 1))) {
+        continue;
+      }
+      enteredFaces[next] |= 1 << (d ^ 1);
+      steps.push_back({next, d ^ 1, uint8_t(step.directions | 1 << d)});
+    }
+  }
+}
+
+bool ChunkPathSearch::reached(glm::ivec3 chunkCoordinate) const {
+  if (!searched) {
+    return true;
+  }
+  int i = cell(chunkCoordinate);
+  return i >= 0 && (enteredFaces[i] & ~OUT_OF_REACH) != 0;
+}
+
+void appendOccluders(glm::ivec3 chunkCoordinate, ChunkConnections connections, glm::ivec3 eyeChunk, std::vector<glm::vec3> &occluders) {
+  // the eye's own chunk could hold it anywhere, even behind its solid faces
+  if (chunkCoordinate == eyeChunk || (connections & ALL_FACES_SOLID) == 0) {
+    return;
+  }
+  for (int d = 0; d < 6; d += 1) {
+    int axis = d / 2;
+    int side = d % 2 == 0 ? 1 : -1;
+    if (!faceSolid(connections, d) || (eyeChunk[axis] - chunkCoordinate[axis]) * side <= 0) {
+      continue;
+    }
+    // through the centers of the face's blocks rather than over their outer faces, so the
+    // chunk's own mesh and its neighbors' stay in front of it
+    glm::vec3 low = glm::vec3(chunkCoordinate * CHUNK_SIZE);
+    glm::vec3 high = low + float(CHUNK_SIZE - 1);
+    for (int i = 0; i < 4; i += 1) {
+      glm::vec3 corner = low;
+      corner[axis] = side > 0 ? high[axis] : low[axis];
+      corner[(axis + 1) % 3] = i == 1 || i == 2 ? high[(axis + 1) % 3] : low[(axis + 1) % 3];
+      corner[(axis + 2) % 3] = i >= 2 ? high[(axis + 2) % 3] : low[(axis + 2) % 3];
+      occluders.push_back(corner * BLOCK_SCALE);
+    }
+  }
+}
+
+MeshWorkers::MeshWorkers(int count) {
+  for (int i = 0; i < count; i += 1) {
+    threads.emplace_back(&MeshWorkers::work, this);
+  }
+}
+
+MeshWorkers::~MeshWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    stopping = true;
+  }
+  jobsReady.notify_all();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (size_t i = nextJob; i < jobs.size(); i += 1) {
+    delete jobs[i]->result;
+    delete jobs[i];
+  }
+  while (MeshJob* job = spareJobs.pop()) {
+    delete job;
+  }
+  while (MeshResult* result = results.pop()) {
+    delete result;
+  }
+  while (MeshResult* result = spareResults.pop()) {
+    delete result;
+  }
+}
+
+MeshJob* MeshWorkers::newJob() {
+  MeshJob* job = spareJobs.pop();
+  if (job != nullptr) {
+    spareJobCount -= 1;
+  } else {
+    job = new MeshJob();
+  }
+  job->result = spareResults.pop();
+  if (job->result != nullptr) {
+    spareResultCount -= 1;
+  } else {
+    job->result = new MeshResult();
+  }
+  unfinishedJobs += 1;
+  return job;
+}
+
+void MeshWorkers::submit(std::vector<MeshJob*> &batch) {
+  {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    // drop the jobs already taken rather than letting the list grow
+    jobs.erase(jobs.begin(), jobs.begin() + nextJob);
+    nextJob = 0;
+    jobs.insert(jobs.end(), batch.begin(), batch.end());
+  }
+  batch.clear();
+  jobsReady.notify_all();
+}
+
+MeshResult* MeshWorkers::nextResult() {
+  return results.pop();
+}
+
+size_t MeshWorkers::waitingJobs() {
+  std::lock_guard<std::mutex> lock(jobsMutex);
+  return jobs.size() - nextJob;
+}
+
+bool MeshWorkers::finished() {
+  return unfinishedJobs == 0;
+}
+
+void MeshWorkers::recycle(MeshResult* result) {
+  if (spareResultCount >= MESH_POOL_SIZE) {
+    delete result;
+    return;
+  }
+  spareResultCount += 1;
+  spareResults.push(result);
+}
+
+void MeshWorkers::work() {
+  while (true) {
+    MeshJob* job;
+    {
+      std::unique_lock<std::mutex> lock(jobsMutex);
+      jobsReady.wait(lock, [this] { return stopping || nextJob < jobs.size(); });
+      if (stopping) {
+        return;
+      }
+      job = jobs[nextJob];
+      nextJob += 1;
+    }
+    MeshResult* result = job->result;
+    job->result = nullptr;
+    mesh(*job, *result);
+    results.push(result);
+    unfinishedJobs -= 1;
+    if (spareJobCount >= MESH_POOL_SIZE) {
+      delete job;
+    } else {
+      spareJobCount += 1;
+      spareJobs.push(job);
+    }
+  }
+}
+
+void MeshWorkers::mesh(MeshJob &job, MeshResult &result) {
+  result.chunkCoordinate = job.chunkCoordinate;
+  result.level = job.level;
+  result.version = job.version;
+  result.queued = job.queued;
+  result.connections = job.chunk.calculateConnections();
+  Chunk* neighbors[6];
+  for (int i = 0; i < 6; i += 1) {
+    neighbors[i] = job.found >> i & 1 ? &job.neighbors[i] : nullptr;
+  }
+  if (job.level == 0) {
+    // only the faces travel with the mesh. their slices are merged again where they are needed,
+    // so the buffers behind them stay with this thread
+    static thread_local ChunkFaceTable table;
+    table.build(job.chunk, neighbors);
+    table.writeMesh(job.chunk, job.chunkCoordinate, result.mesh);
+    memcpy(result.faces, table.getMasks(), sizeof(result.faces));
+  } else {
+    Chunk coarseNeighbors[6];
+    for (int i = 0; i < 6; i += 1) {
+      if (neighbors[i] != nullptr) {
+        coarseNeighbors[i] = neighbors[i]->downsample(job.level);
+        neighbors[i] = &coarseNeighbors[i];
+      }
+    }
+    job.chunk.downsample(job.level).calculateChunkMesh(job.chunkCoordinate, neighbors, result.mesh);
+  }
+}
+
+RenderGod::RenderGod(World &world, Scene &openGLScene, int meshWorkers): God(world), scene(openGLScene), workers(meshWorkers) {
   scene.createSun("sun", {
     glm::vec3()
   });
 }
 
+RenderGod::~RenderGod() {
+  for (MeshResult* result : readyMeshes) {
+    delete result;
+  }
+}
+
 void RenderGod::updateSun() {
   // each hour is 60
   const int hour = 60;
@@ -848,42 +1883,209 @@ void RenderGod::updateSun() {
   scene.setBackground(skyColor);
 }
 
-void RenderGod::uploadCache(int max) {
-  world.divineIntervention.lock();
-  std::vector<glm::ivec3> uploaded;
-  for (auto it : cache) {
-    if (max == 0) {
+void RenderGod::uploadCache(size_t byteBudget) {
+  // results come straight off the workers' queue, so neither side waits on the other. they
+  // wait here until their turn, dropping any overtaken by a newer mesh or whose chunk was culled
+  bool finished = workers.finished();
+  bool arrived = false;
+  while (MeshResult* result = workers.nextResult()) {
+    auto shown = shownVersions.find(result->chunkCoordinate);
+    if (shown != shownVersions.end() && result->version <= shown->second) {
+      workers.recycle(result);
+      continue;
+    }
+    readyMeshes.push_back(result);
+    arrived = true;
+  }
+  if (arrived) {
+    glm::vec3 originCenter = glm::vec3(origin) / float(CHUNK_SIZE);
+    std::sort(readyMeshes.begin(), readyMeshes.end(), [originCenter](MeshResult* a, MeshResult* b) {
+      return glm::distance(glm::vec3(a->chunkCoordinate), originCenter) > glm::distance(glm::vec3(b->chunkCoordinate), originCenter);
+    });
+  }
+  auto now = std::chrono::steady_clock::now();
+  float totalLatency = 0;
+  uploadStats.uploaded = 0;
+  uploadStats.bytes = 0;
+  uploadStats.maxLatency = 0;
+  while (!readyMeshes.empty()) {
+    MeshResult* result = readyMeshes.back();
+    RenderCache &mesh = result->mesh;
+    size_t bytes = UPLOAD_MESH_OVERHEAD + mesh.chunkVertices.size() * sizeof(ChunkVertex) + mesh.vertices.size() * sizeof(VBOVertex) + mesh.indices.size() * sizeof(GLuint);
+    if (uploadStats.uploaded > 0 && uploadStats.bytes + bytes > byteBudget) {
       break;
     }
-    scene.createMeshFromCache(Chunk::id(it.first), it.second);
-    uploaded.push_back(it.first);
-    max -= 1;
+    readyMeshes.pop_back();
+    glm::ivec3 chunkCoordinate = result->chunkCoordinate;
+    // a newer mesh of the chunk may have gone up while this one waited
+    auto shown = shownVersions.find(chunkCoordinate);
+    if (shown == shownVersions.end() || result->version > shown->second) {
+      shownVersions[chunkCoordinate] = result->version;
+      // remeshed chunks overwrite their stale mesh
+      chunkMeshes[chunkCoordinate] = scene.updateMeshFromCache(chunkMeshes[chunkCoordinate], mesh, 0);
+      connections[chunkCoordinate] = result->connections;
+      sealedDirty = true;
+      if (result->level == 0) {
+        // the table merges its slices again on the first edit, into buffers it keeps
+        faceTables[chunkCoordinate].build(result->faces);
+      } else {
+        faceTables.erase(chunkCoordinate);
+      }
+      float latency = std::chrono::duration<float, std::milli>(now - result->queued).count();
+      totalLatency += latency;
+      uploadStats.maxLatency = std::max(uploadStats.maxLatency, latency);
+      uploadStats.uploaded += 1;
+      uploadStats.bytes += bytes;
+    }
+    workers.recycle(result);
   }
-  for (glm::ivec3 chunk : uploaded) {
-    cache.erase(chunk);
+  // with no mesh left on its way, culled chunks no longer need their versions to drop them.
+  // chunks that came back into range and went up since keep theirs
+  if (finished && readyMeshes.empty()) {
+    for (glm::ivec3 chunkCoordinate : culledChunks) {
+      if (chunkMeshes.find(chunkCoordinate) == chunkMeshes.end()) {
+        shownVersions.erase(chunkCoordinate);
+      }
+    }
+    culledChunks.clear();
   }
-  world.divineIntervention.unlock();
+  uploadStats.averageLatency = uploadStats.uploaded > 0 ? totalLatency / uploadStats.uploaded : 0;
+  uploadStats.waiting = readyMeshes.size();
+  uploadStats.meshing = workers.waitingJobs();
+}
+
+UploadStats RenderGod::getUploadStats() {
+  return uploadStats;
 }
 
 void RenderGod::cullFarChunks(int allowance, int max) {
   glm::ivec3 originChunk = World::blockToChunkCoordinate(origin);
-  for (glm::ivec3 chunkCoordinate : realm) {
-    if (max == 0) {
-      break;
-    }
+  for (auto it = realm.begin(); it != realm.end() && max > 0;) {
+    glm::ivec3 chunkCoordinate = *it;
     if (glm::distance(glm::vec3(chunkCoordinate), glm::vec3(originChunk)) <= radius + allowance) {
+      it++;
       continue;
     }
-    scene.deleteMesh(Chunk::id(chunkCoordinate));
-    realm.erase(chunkCoordinate);
+    auto chunkMesh = chunkMeshes.find(chunkCoordinate);
+    if (chunkMesh != chunkMeshes.end()) {
+      scene.deleteMesh(chunkMesh->second);
+      chunkMeshes.erase(chunkMesh);
+    }
+    auto state = meshStates.find(chunkCoordinate);
+    if (state != meshStates.end()) {
+      // drop the mesh of the chunk if it is still being made
+      shownVersions[chunkCoordinate] = state->second.version;
+      meshStates.erase(state);
+    }
+    culledChunks.push_back(chunkCoordinate);
+    faceTables.erase(chunkCoordinate);
+    connections.erase(chunkCoordinate);
+    sealedDirty = true;
+    it = realm.erase(it);
     max -= 1;
   }
 }
 
-// update the cache
+void RenderGod::updateBlock(glm::ivec3 blockCoordinate) {
+  // the block and each block beside it, which may be in the chunks next door
+  glm::ivec3 touched[7];
+  int touchedCount = 0;
+  for (int i = -1; i < 6; i += 1) {
+    glm::ivec3 block = blockCoordinate + (i < 0 ? glm::ivec3(0) : ORTHO_DIRS[i]);
+    glm::ivec3 chunkCoordinate = World::blockToChunkCoordinate(block);
+    auto state = meshStates.find(chunkCoordinate);
+    if (state == meshStates.end()) {
+      continue;
+    }
+    auto table = faceTables.find(chunkCoordinate);
+    auto shown = shownVersions.find(chunkCoordinate);
+    if (table == faceTables.end() || shown == shownVersions.end() || shown->second != state->second.version) {
+      // coarse chunks, and chunks with a newer mesh on the way, are left for the next update to remesh
+      meshStates.erase(state);
+      continue;
+    }
+    // cull against the same neighbors the chunk was meshed against
+    Chunk* neighbors[6];
+    for (int d = 0; d < 6; d += 1) {
+      bool culled = state->second.neighbors >> d & 1;
+      neighbors[d] = culled ? &world.getChunk(chunkCoordinate + ORTHO_DIRS[d]) : nullptr;
+    }
+    table->second.updateBlock(world.getChunk(chunkCoordinate), neighbors, block - chunkCoordinate * CHUNK_SIZE);
+    if (std::find(touched, touched + touchedCount, chunkCoordinate) == touched + touchedCount) {
+      touched[touchedCount] = chunkCoordinate;
+      touchedCount += 1;
+    }
+  }
+  for (int i = 0; i < touchedCount; i += 1) {
+    glm::ivec3 chunkCoordinate = touched[i];
+    size_t firstVertex = faceTables[chunkCoordinate].writeMesh(world.getChunk(chunkCoordinate), chunkCoordinate, patch);
+    chunkMeshes[chunkCoordinate] = scene.updateMeshFromCache(chunkMeshes[chunkCoordinate], patch, firstVertex);
+  }
+  // only the block's own chunk can open or close a path, whatever state its mesh is in
+  glm::ivec3 blockChunk = World::blockToChunkCoordinate(blockCoordinate);
+  auto connection = connections.find(blockChunk);
+  if (connection != connections.end()) {
+    connection->second = world.getChunk(blockChunk).calculateConnections();
+    sealedDirty = true;
+  }
+}
+
+void RenderGod::hideSealedChunks(glm::vec3 eye) {
+  // blocks are centered on their coordinates
+  glm::ivec3 eyeChunk = World::blockToChunkCoordinate(glm::ivec3(glm::floor(eye + 0.5f)));
+  if (!sealedDirty && eyeChunk == sealedFrom) {
+    return;
+  }
+  sealedDirty = false;
+  sealedFrom = eyeChunk;
+  pathSearch.search(connections, eyeChunk, World::blockToChunkCoordinate(origin), radius + 1);
+  occluders.clear();
+  for (auto &entry : connections) {
+    bool reached = pathSearch.reached(entry.first);
+    auto chunkMesh = chunkMeshes.find(entry.first);
+    Mesh* mesh = chunkMesh == chunkMeshes.end() ? nullptr : scene.getMesh(chunkMesh->second);
+    if (mesh != nullptr) {
+      mesh->setOccluded(!reached);
+    }
+    if (reached) {
+      appendOccluders(entry.first, entry.second, eyeChunk, occluders);
+    }
+  }
+  scene.setOccluders(occluders);
+}
+
+int RenderGod::levelOfDetail(glm::ivec3 chunkCoordinate) {
+  float distance = glm::distance(glm::vec3(chunkCoordinate), glm::vec3(origin) / float(CHUNK_SIZE));
+  int level = levelForDistance(distance);
+  auto state = meshStates.find(chunkCoordinate);
+  if (state == meshStates.end() || state->second.level == level) {
+    return level;
+  }
+  // keep the current level until the chunk is clearly past the edge of its band
+  int current = state->second.level;
+  bool farEnough = current == 0 || distance > LOD_DISTANCES[current - 1] - LOD_HYSTERESIS;
+  bool nearEnough = current == LOD_LEVELS - 1 || distance < LOD_DISTANCES[current] + LOD_HYSTERESIS;
+  return farEnough && nearEnough ? current : level;
+}
+
+uint8_t RenderGod::gatherNeighbors(glm::ivec3 chunkCoordinate, int level, Chunk* neighbors[6]) {
+  uint8_t found = 0;
+  for (int i = 0; i < 6; i += 1) {
+    glm::ivec3 neighbor = chunkCoordinate + ORTHO_DIRS[i];
+    auto neighborLevel = levels.find(neighbor);
+    bool sameLevel = (neighborLevel != levels.end() ? neighborLevel->second : levelOfDetail(neighbor)) == level;
+    neighbors[i] = sameLevel && world.hasChunk(neighbor) ? &world.getChunk(neighbor) : nullptr;
+    found |= neighbors[i] != nullptr ? 1 << i : 0;
+  }
+  return found;
+}
+
+// queue the chunks that need meshing
 void RenderGod::update() {
-  int chunkCount = 0;
   glm::ivec3 originChunk = World::blockToChunkCoordinate(origin);
+  // settle every chunk's level of detail first, so each chunk knows which of its neighbors
+  // it shares a seam with. entries are overwritten rather than cleared, so the map keeps its nodes
+  world.divineIntervention.lock();
   for (int z = originChunk.z - radius; z < originChunk.z + radius; z += 1) {
     for (int y = originChunk.y - radius; y < originChunk.y + radius; y += 1) {
       for (int x = originChunk.x - radius; x < originChunk.x + radius; x += 1) {
@@ -894,42 +2096,73 @@ void RenderGod::update() {
           // std::cout << "out of chunk render sphere" << std::endl;
           continue;
         }
-        // if the chunk is already cached, it must be up to date
-        if (realm.find(chunkCoordinate) != realm.end()) {
-          // std::cout << "chunk already cached" << std::endl;
-          continue;
-        }
-        // TODO: if a chunk does not exist, we should generate it instead of skipping it
-        // std::cout << "lock 2" << std::endl;
-        world.divineIntervention.lock();
-        if (!world.hasChunk(chunkCoordinate)) {
-          world.divineIntervention.unlock();
-          
-        // std::cout << "unlock 2 here" << std::endl;
-          // std::cout << "chunk does not exist" << std::endl;
-          continue;
-        }
-        realm.insert(chunkCoordinate);
-        chunkCount += 1;
-
-          // std::cout << "rendering chunk!------------" << std::endl;
-        OBJModel model = scaleOBJ(offsetOBJ(world.getChunk(chunkCoordinate).calculateChunkOBJ(), glm::vec3(chunkCoordinate * CHUNK_SIZE)), BLOCK_SCALE);
-        model.vertexNormals.push_back({0, 0, 0});
-        model.mtl.mapKD = "media/textures.ppm";
-        world.divineIntervention.unlock();
-        
-        // std::cout << "unlock 2" << std::endl;
+        levels[chunkCoordinate] = levelOfDetail(chunkCoordinate);
+      }
+    }
+  }
+  world.divineIntervention.unlock();
+  for (auto it = levels.begin(); it != levels.end();) {
+    if (glm::distance(glm::vec3(it->first), glm::vec3(origin) / float(CHUNK_SIZE)) > radius) {
+      it = levels.erase(it);
+    } else {
+      it++;
+    }
+  }
 
-        std::vector<VBOVertex> data;
-        std::vector<GLuint> indices;
-        if (!encodeOBJ(model, data, indices)) {
-          throw std::invalid_argument("Invalid OBJ cannot be loaded into VBO.");
-        }
-        cache[chunkCoordinate] = {data, indices, "media/textures.ppm"};
+  for (auto entry : levels) {
+    glm::ivec3 chunkCoordinate = entry.first;
+    int level = entry.second;
+    // TODO: if a chunk does not exist, we should generate it instead of skipping it
+    // std::cout << "lock 2" << std::endl;
+    world.divineIntervention.lock();
+    if (!world.hasChunk(chunkCoordinate)) {
+      world.divineIntervention.unlock();
+      
+    // std::cout << "unlock 2 here" << std::endl;
+      // std::cout << "chunk does not exist" << std::endl;
+      continue;
+    }
+    // faces are only culled against neighbors at the same level of detail. across a seam
+    // both chunks keep their border faces, which covers any gap between the two resolutions
+    Chunk* neighbors[6];
+    uint8_t found = gatherNeighbors(chunkCoordinate, level, neighbors);
+    // a chunk's mesh is up to date unless its level changed or a neighbor it culls against
+    // has arrived or left
+    auto state = meshStates.find(chunkCoordinate);
+    if (state != meshStates.end() && state->second.level == level && state->second.neighbors == found) {
+      world.divineIntervention.unlock();
+      continue;
+    }
+    realm.insert(chunkCoordinate);
+    meshVersion += 1;
+    meshStates[chunkCoordinate] = {level, found, meshVersion};
+
+      // std::cout << "rendering chunk!------------" << std::endl;
+    // the workers mesh a copy of the blocks, so the world is free to change while they do
+    MeshJob* job = workers.newJob();
+    job->chunkCoordinate = chunkCoordinate;
+    job->level = level;
+    job->version = meshVersion;
+    std::memcpy(job->chunk.blocks, world.getChunk(chunkCoordinate).blocks, sizeof(job->chunk.blocks));
+    for (int i = 0; i < 6; i += 1) {
+      if (neighbors[i] != nullptr) {
+        std::memcpy(job->neighbors[i].blocks, neighbors[i]->blocks, sizeof(job->neighbors[i].blocks));
       }
     }
+    job->found = found;
+    job->queued = std::chrono::steady_clock::now();
+    pendingJobs.push_back(job);
+    world.divineIntervention.unlock();
+    
+    // std::cout << "unlock 2" << std::endl;
   }
-  std::cout <<"Rendering THIS MANY CHUNKS: " << chunkCount << std::endl;
+  // the nearest chunks show up first
+  glm::vec3 originCenter = glm::vec3(origin) / float(CHUNK_SIZE);
+  std::sort(pendingJobs.begin(), pendingJobs.end(), [originCenter](MeshJob* a, MeshJob* b) {
+    return glm::distance(glm::vec3(a->chunkCoordinate), originCenter) < glm::distance(glm::vec3(b->chunkCoordinate), originCenter);
+  });
+  std::cout <<"Rendering THIS MANY CHUNKS: " << pendingJobs.size() << std::endl;
+  workers.submit(pendingJobs);
 }
 
 #endif
\ No newline at end of file
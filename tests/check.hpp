@@ -0,0 +1,28 @@
+#ifndef CHECK_H
+#define CHECK_H
+#include <iostream>
+
+// how many checks have failed so far. a failed check doesn't stop the test, so that one run
+// reports every failure
+inline int& checkFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition) \
+  if (!(condition)) { \
+    std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << std::endl; \
+    checkFailures() += 1; \
+  }
+
+// report how the test went, giving the exit status for main to return
+inline int checkResult(const char* test) {
+  if (checkFailures() > 0) {
+    std::cout << test << ": " << checkFailures() << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << test << ": passed" << std::endl;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "World.hpp"
+#include "check.hpp"
+#include <cstring>
+
+// the two integer attributes the vertex shader reads a packed chunk vertex as
+struct UnpackedVertex {
+  // (x, y, z, normal index)
+  uint8_t chunkPosition[4];
+  // (block type, corner, slot low byte, slot high byte)
+  uint8_t chunkFace[4];
+};
+
+// read the bytes of a vertex the way ChunkArena points the vertex array at them
+UnpackedVertex unpack(const ChunkVertex &vertex) {
+  uint8_t bytes[sizeof(ChunkVertex)];
+  memcpy(bytes, &vertex, sizeof(ChunkVertex));
+  UnpackedVertex unpacked;
+  memcpy(unpacked.chunkPosition, bytes, 4);
+  memcpy(unpacked.chunkFace, bytes + 4, 4);
+  return unpacked;
+}
+
+int shaderSlot(const UnpackedVertex &unpacked) {
+  return unpacked.chunkFace[2] | unpacked.chunkFace[3] << 8;
+}
+
+void testEveryField() {
+  const int SLOTS[] = {0, 1, 255, 256, 257, 4660, 65280, 65535};
+  const uint8_t TYPES[] = {BLOCKTYPE_STONE, BLOCKTYPE_GRASS, BLOCKTYPE_LEAVES, BLOCKTYPE_WATER, 255};
+  int mismatches = 0;
+  for (int x = 0; x <= CHUNK_SIZE; x += 1) {
+    for (int y = 0; y <= CHUNK_SIZE; y += 1) {
+      for (int z = 0; z <= CHUNK_SIZE; z += 1) {
+        int normal = (x + y + z) % 6;
+        int corner = (x * 3 + z) % 4;
+        uint8_t type = TYPES[(x + y) % 5];
+        int slot = SLOTS[(y + z) % 8];
+        ChunkVertex vertex(glm::ivec3(x, y, z), normal, type, corner);
+        vertex.setSlot(slot);
+        UnpackedVertex unpacked = unpack(vertex);
+        bool matches = unpacked.chunkPosition[0] == x && unpacked.chunkPosition[1] == y
+          && unpacked.chunkPosition[2] == z && unpacked.chunkPosition[3] == normal
+          && unpacked.chunkFace[0] == type && unpacked.chunkFace[1] == corner
+          && shaderSlot(unpacked) == slot && vertex.getSlot() == slot;
+        mismatches += !matches;
+      }
+    }
+  }
+  CHECK(mismatches == 0);
+}
+
+void testLayout() {
+  CHECK(sizeof(ChunkVertex) == 8);
+  ChunkVertex vertex(glm::ivec3(0), 0, 0, 0);
+  CHECK(vertex.getSlot() == 0);
+  // the slot can number every slot of the arena and no more
+  vertex.setSlot(CHUNK_ARENA_SLOTS - 1);
+  CHECK(shaderSlot(unpack(vertex)) == int(CHUNK_ARENA_SLOTS - 1));
+  vertex.setSlot(CHUNK_ARENA_SLOTS);
+  CHECK(shaderSlot(unpack(vertex)) == 0);
+}
+
+// a lone block meshes into six quads whose vertices unpack onto the block's corners
+void testMeshedBlock() {
+  Chunk chunk;
+  memset(chunk.blocks, BLOCKTYPE_AIR, sizeof(chunk.blocks));
+  glm::ivec3 block = {3, 4, 5};
+  chunk.blocks[block.z][block.y][block.x] = BLOCKTYPE_STONE;
+  Chunk* neighbors[6] = {};
+  RenderCache mesh;
+  chunk.calculateChunkMesh(glm::ivec3(0), neighbors, mesh);
+  CHECK(mesh.chunkVertices.size() == 24);
+  int faces[6] = {};
+  for (const ChunkVertex &vertex : mesh.chunkVertices) {
+    UnpackedVertex unpacked = unpack(vertex);
+    glm::ivec3 position = {unpacked.chunkPosition[0], unpacked.chunkPosition[1], unpacked.chunkPosition[2]};
+    int normal = unpacked.chunkPosition[3];
+    CHECK(normal < 6);
+    if (normal >= 6) {
+      continue;
+    }
+    faces[normal] += 1;
+    CHECK(glm::all(glm::greaterThanEqual(position, block)));
+    CHECK(glm::all(glm::lessThanEqual(position, block + 1)));
+    // the vertex lies on the side of the block its normal points out of
+    glm::ivec3 facing = ORTHO_DIRS[normal];
+    int axis = facing.x != 0 ? 0 : facing.y != 0 ? 1 : 2;
+    CHECK(position[axis] == block[axis] + (facing[axis] > 0 ? 1 : 0));
+    CHECK(unpacked.chunkFace[0] == BLOCKTYPE_STONE);
+    CHECK(unpacked.chunkFace[1] < 4);
+  }
+  for (int d = 0; d < 6; d += 1) {
+    CHECK(faces[d] == 4);
+  }
+}
+
+int main() {
+  testEveryField();
+  testLayout();
+  testMeshedBlock();
+  return checkResult("chunk_vertex_test");
+}
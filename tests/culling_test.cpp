@@ -0,0 +1,318 @@
+#include "World.hpp"
+#include "check.hpp"
+#include <random>
+#include <set>
+#include <tuple>
+#include <glm/gtc/matrix_transform.hpp>
+
+// whether a point is inside clip space
+bool insideClipSpace(const glm::mat4 &projectionView, glm::vec3 point) {
+  glm::vec4 clip = projectionView * glm::vec4(point, 1);
+  return clip.w > 0 && std::abs(clip.x) <= clip.w && std::abs(clip.y) <= clip.w && std::abs(clip.z) <= clip.w;
+}
+
+glm::mat4 randomView(std::mt19937 &random, glm::vec3 &eye) {
+  std::uniform_real_distribution<float> unit(-1, 1);
+  eye = glm::vec3(unit(random), unit(random), unit(random)) * 50.0f;
+  glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+  return glm::lookAt(eye, eye + direction, glm::vec3(0, 1, 0));
+}
+
+// the extracted planes keep the same points in as clip space does
+void testFrustumPlanes() {
+  std::mt19937 random(3);
+  std::uniform_real_distribution<float> unit(-1, 1);
+  int disagreements = 0;
+  int inside = 0;
+  for (int view = 0; view < 200; view += 1) {
+    glm::vec3 eye;
+    glm::mat4 viewMatrix = randomView(random, eye);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f + unit(random) * 10), 1.6f, 0.1f, 64.0f);
+    glm::mat4 projectionView = projection * viewMatrix;
+    Frustum frustum = extractFrustum(projectionView);
+    for (int i = 0; i < 200; i += 1) {
+      glm::vec3 point = eye + glm::vec3(unit(random), unit(random), unit(random)) * 70.0f;
+      bool inPlanes = true;
+      float margin = INFINITY;
+      for (const glm::vec4 &plane : frustum.planes) {
+        float distance = glm::dot(glm::vec3(plane), point) + plane.w;
+        inPlanes = inPlanes && distance >= 0;
+        margin = std::min(margin, std::abs(distance));
+      }
+      // points right on a plane can land either way
+      if (margin < 1e-3f) {
+        continue;
+      }
+      bool inClip = insideClipSpace(projectionView, point);
+      inside += inClip;
+      disagreements += inClip != inPlanes;
+      disagreements += intersectsFrustum(frustum, AABB{point, point}) != inPlanes;
+    }
+  }
+  CHECK(inside > 100);
+  CHECK(disagreements == 0);
+}
+
+// the batch culls exactly the boxes intersectsFrustum does, and never a box with a corner or
+// its center inside clip space
+void testBatchCull() {
+  std::mt19937 random(5);
+  std::uniform_real_distribution<float> unit(-1, 1);
+  int disagreements = 0;
+  int culledInside = 0;
+  size_t culled = 0;
+  for (int view = 0; view < 200; view += 1) {
+    glm::vec3 eye;
+    glm::mat4 projectionView = glm::perspective(glm::radians(45.0f), 1.6f, 0.1f, 64.0f) * randomView(random, eye);
+    Frustum frustum = extractFrustum(projectionView);
+    AABBBatch batch;
+    std::vector<AABB> boxes;
+    // an odd count, so the last group of four is partly empty
+    for (int i = 0; i < 1003; i += 1) {
+      glm::vec3 center = eye + glm::vec3(unit(random), unit(random), unit(random)) * 80.0f;
+      glm::vec3 extent = glm::abs(glm::vec3(unit(random), unit(random), unit(random))) * 8.0f;
+      boxes.push_back({center - extent, center + extent});
+      batch.add(boxes.back());
+    }
+    CHECK(batch.size() == boxes.size());
+    std::vector<uint8_t> visible;
+    size_t count = batch.cull(frustum, visible);
+    size_t counted = 0;
+    for (size_t i = 0; i < boxes.size(); i += 1) {
+      counted += visible[i];
+      disagreements += bool(visible[i]) != intersectsFrustum(frustum, boxes[i]);
+      if (visible[i]) {
+        continue;
+      }
+      culled += 1;
+      for (int corner = 0; corner < 9; corner += 1) {
+        glm::vec3 point = (boxes[i].min + boxes[i].max) * 0.5f;
+        if (corner < 8) {
+          point = glm::mix(boxes[i].min, boxes[i].max, glm::vec3(corner & 1, corner >> 1 & 1, corner >> 2 & 1));
+        }
+        // shrunk a little, so that points on a plane don't count
+        glm::vec4 clip = projectionView * glm::vec4(point, 1);
+        float w = clip.w * 0.999f;
+        culledInside += clip.w > 0 && std::abs(clip.x) < w && std::abs(clip.y) < w && std::abs(clip.z) < w;
+      }
+    }
+    CHECK(count == counted);
+  }
+  CHECK(culled > 1000);
+  CHECK(disagreements == 0);
+  CHECK(culledInside == 0);
+}
+
+// the level of detail RenderGod would mesh a chunk at, seen from the origin
+int levelOfDetail(glm::ivec3 chunkCoordinate) {
+  return levelForDistance(glm::length(glm::vec3(chunkCoordinate)));
+}
+
+// the face directions left out for an eye only ever hold quads facing away from it
+void testFacingDirections(World &world, int radius) {
+  const glm::vec3 EYES[3] = {{8.3f, -3.2f, 8.7f}, {40.5f, 2.1f, -20.2f}, {-70, 30, 5}};
+  for (glm::vec3 eye : EYES) {
+    size_t quads = 0;
+    size_t kept = 0;
+    int frontFacingDropped = 0;
+    int misfiled = 0;
+    for (int z = -radius; z <= radius; z += 1) {
+      for (int y = -radius; y <= radius; y += 1) {
+        for (int x = -radius; x <= radius; x += 1) {
+          glm::ivec3 chunkCoordinate = {x, y, z};
+          if (glm::length(glm::vec3(chunkCoordinate)) > radius) {
+            continue;
+          }
+          int level = levelOfDetail(chunkCoordinate);
+          Chunk* neighbors[6];
+          Chunk coarseNeighbors[6];
+          for (int d = 0; d < 6; d += 1) {
+            glm::ivec3 neighbor = chunkCoordinate + ORTHO_DIRS[d];
+            neighbors[d] = levelOfDetail(neighbor) == level ? &world.getChunk(neighbor) : nullptr;
+            if (neighbors[d] != nullptr && level > 0) {
+              coarseNeighbors[d] = neighbors[d]->downsample(level);
+              neighbors[d] = &coarseNeighbors[d];
+            }
+          }
+          RenderCache mesh;
+          if (level > 0) {
+            world.getChunk(chunkCoordinate).downsample(level).calculateChunkMesh(chunkCoordinate, neighbors, mesh);
+          } else {
+            world.getChunk(chunkCoordinate).calculateChunkMesh(chunkCoordinate, neighbors, mesh);
+          }
+          glm::vec3 localEye = eye - mesh.origin;
+          uint8_t facing = facingDirections(localEye);
+          size_t vertex = 0;
+          for (int pass = 0; pass < RENDER_PASSES; pass += 1) {
+            for (int d = 0; d < 6; d += 1) {
+              size_t count = mesh.faceVertices[pass][d];
+              quads += count / 4;
+              kept += (facing >> d & 1) * count / 4;
+              for (size_t v = vertex; v < vertex + count; v += 4) {
+                const ChunkVertex &corner = mesh.chunkVertices[v];
+                misfiled += corner.normal != d;
+                glm::vec3 position = glm::vec3(corner.x, corner.y, corner.z);
+                bool frontFacing = glm::dot(glm::vec3(ORTHO_DIRS[corner.normal]), localEye - position) > 0;
+                frontFacingDropped += !(facing >> d & 1) && frontFacing;
+              }
+              vertex += count;
+            }
+          }
+        }
+      }
+    }
+    CHECK(misfiled == 0);
+    CHECK(frontFacingDropped == 0);
+    // something is left out from anywhere
+    CHECK(kept < quads);
+  }
+}
+
+// the chunks a search through every (chunk, entry face, directions moved) state reaches, with
+// none of ChunkPathSearch's pruning
+std::set<std::tuple<int, int, int>> exhaustiveSearch(const std::unordered_map<glm::ivec3, ChunkConnections> &connections, glm::ivec3 eyeChunk, glm::ivec3 center, float maxDistance) {
+  struct State {
+    glm::ivec3 chunk;
+    int face;
+    int directions;
+  };
+  std::set<std::tuple<int, int, int, int, int>> seen;
+  std::set<std::tuple<int, int, int>> reached;
+  std::vector<State> states = {{eyeChunk, -1, 0}};
+  reached.insert(std::make_tuple(eyeChunk.x, eyeChunk.y, eyeChunk.z));
+  while (!states.empty()) {
+    State state = states.back();
+    states.pop_back();
+    auto found = connections.find(state.chunk);
+    ChunkConnections open = state.face < 0 || found == connections.end() ? ALL_FACES_CONNECTED : found->second;
+    for (int d = 0; d < 6; d += 1) {
+      if ((state.directions >> (d ^ 1) & 1) || (state.face >= 0 && !facesConnect(open, state.face, d))) {
+        continue;
+      }
+      glm::ivec3 next = state.chunk + ORTHO_DIRS[d];
+      if (glm::length(glm::vec3(next - center)) > maxDistance) {
+        continue;
+      }
+      int directions = state.directions | 1 << d;
+      if (!seen.insert(std::make_tuple(next.x, next.y, next.z, d ^ 1, directions)).second) {
+        continue;
+      }
+      reached.insert(std::make_tuple(next.x, next.y, next.z));
+      states.push_back({next, d ^ 1, directions});
+    }
+  }
+  return reached;
+}
+
+// from open blocks underground, the search reaches the same chunks as the exhaustive one, and
+// whatever a ray from the eye hits first lies in a chunk it reached
+void testPathSearch(World &world, ChunkGenerator &generator, int seed) {
+  const int RADIUS = 6;
+  std::mt19937 random(seed);
+  int eyes = 0;
+  int disagreements = 0;
+  int raysIntoHidden = 0;
+  size_t hidden = 0;
+  while (eyes < 3) {
+    glm::ivec3 eyeChunk = {int(random() % 5) - 2, -3 - int(random() % 3), int(random() % 5) - 2};
+    for (int z = -RADIUS - 1; z <= RADIUS + 1; z += 1) {
+      for (int y = -RADIUS - 1; y <= RADIUS + 1; y += 1) {
+        for (int x = -RADIUS - 1; x <= RADIUS + 1; x += 1) {
+          glm::ivec3 chunkCoordinate = eyeChunk + glm::ivec3(x, y, z);
+          if (!world.hasChunk(chunkCoordinate)) {
+            world.setChunk(chunkCoordinate, generator.generateChunk(chunkCoordinate));
+          }
+        }
+      }
+    }
+    Chunk &chunk = world.getChunk(eyeChunk);
+    glm::ivec3 eye = glm::ivec3(-1);
+    for (int i = 0; i < 4096 && eye.x < 0; i += 1) {
+      int block = random() % 4096;
+      if (chunk.blocks[block / 256][block / 16 % 16][block % 16] == BLOCKTYPE_AIR) {
+        eye = glm::ivec3(block % 16, block / 16 % 16, block / 256);
+      }
+    }
+    if (eye.x < 0) {
+      continue;
+    }
+    eyes += 1;
+    std::unordered_map<glm::ivec3, ChunkConnections> connections;
+    for (int z = -RADIUS; z <= RADIUS; z += 1) {
+      for (int y = -RADIUS; y <= RADIUS; y += 1) {
+        for (int x = -RADIUS; x <= RADIUS; x += 1) {
+          if (glm::length(glm::vec3(x, y, z)) <= RADIUS) {
+            glm::ivec3 chunkCoordinate = eyeChunk + glm::ivec3(x, y, z);
+            connections[chunkCoordinate] = world.getChunk(chunkCoordinate).calculateConnections();
+          }
+        }
+      }
+    }
+    ChunkPathSearch search;
+    search.search(connections, eyeChunk, eyeChunk, RADIUS + 1);
+    std::set<std::tuple<int, int, int>> reached = exhaustiveSearch(connections, eyeChunk, eyeChunk, RADIUS + 1);
+    for (auto &entry : connections) {
+      glm::ivec3 chunkCoordinate = entry.first;
+      bool exhaustive = reached.count(std::make_tuple(chunkCoordinate.x, chunkCoordinate.y, chunkCoordinate.z)) > 0;
+      disagreements += search.reached(chunkCoordinate) != exhaustive;
+      hidden += !search.reached(chunkCoordinate);
+    }
+    glm::vec3 from = glm::vec3(eyeChunk * CHUNK_SIZE + eye);
+    std::normal_distribution<float> normal;
+    for (int ray = 0; ray < 2000; ray += 1) {
+      glm::vec3 direction = glm::vec3(normal(random), normal(random), normal(random));
+      glm::ivec3 hit, before;
+      if (world.castRay(from, direction, (RADIUS - 1) * CHUNK_SIZE, hit, before)) {
+        glm::ivec3 hitChunk = World::blockToChunkCoordinate(hit);
+        raysIntoHidden += connections.count(hitChunk) > 0 && !search.reached(hitChunk);
+      }
+    }
+  }
+  CHECK(disagreements == 0);
+  CHECK(raysIntoHidden == 0);
+  // underground, rock seals something off
+  CHECK(hidden > 0);
+}
+
+// an eye out of reach of the center hides nothing, and closed chunks hide what is behind them
+void testSearchBounds() {
+  std::unordered_map<glm::ivec3, ChunkConnections> connections;
+  connections[glm::ivec3(1, 0, 0)] = 0;
+  ChunkPathSearch search;
+  search.search(connections, glm::ivec3(10, 0, 0), glm::ivec3(0), 4);
+  CHECK(search.reached(glm::ivec3(1, 0, 0)));
+  // a wall of chunks closed on every side is reached, as the eye sees into it, but nothing
+  // behind it is, as it reaches past the edge of the search
+  connections.clear();
+  for (int z = -4; z <= 4; z += 1) {
+    for (int y = -4; y <= 4; y += 1) {
+      connections[glm::ivec3(1, y, z)] = 0;
+    }
+  }
+  search.search(connections, glm::ivec3(0), glm::ivec3(0), 3);
+  CHECK(search.reached(glm::ivec3(1, 0, 0)));
+  CHECK(!search.reached(glm::ivec3(2, 0, 0)));
+  CHECK(search.reached(glm::ivec3(-2, 0, 0)));
+}
+
+int main() {
+  testFrustumPlanes();
+  testBatchCull();
+  for (std::string generatorName : {"noise", "simplex"}) {
+    const int RADIUS = 6;
+    ChunkGenerator* generator = createChunkGenerator(generatorName, 12345);
+    World world(12345);
+    for (int z = -RADIUS - 1; z <= RADIUS + 1; z += 1) {
+      for (int y = -RADIUS - 1; y <= RADIUS + 1; y += 1) {
+        for (int x = -RADIUS - 1; x <= RADIUS + 1; x += 1) {
+          world.setChunk(glm::ivec3(x, y, z), generator->generateChunk(glm::ivec3(x, y, z)));
+        }
+      }
+    }
+    testFacingDirections(world, RADIUS);
+    testPathSearch(world, *generator, 12345);
+    delete generator;
+  }
+  testSearchBounds();
+  return checkResult("culling_test");
+}
@@ -0,0 +1,66 @@
+#include "World.hpp"
+#include "glstub.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+const int ENTITIES = 10000;
+const int FRAMES = 60;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// spawn 10,000 entities over a few chunks and draw them every frame the way the game does,
+// through EntityGod::drawEntities and then Scene::draw, with the GL stubbed out
+int main() {
+  if (!loadStubGL()) {
+    printf("could not load the GL stub\n");
+    return 1;
+  }
+  Camera camera;
+  Scene scene(640, 480, camera);
+  scene.setViewDistance(1000);
+  World world(1);
+  for (int z = -4; z < 4; z += 1) {
+    for (int x = -4; x < 4; x += 1) {
+      world.setChunk(glm::ivec3(x, 0, z), Chunk());
+    }
+  }
+  EntityGod god(world);
+  std::mt19937 random(5);
+  for (int i = 0; i < ENTITIES; i += 1) {
+    glm::vec3 position(int(random() % 120) - 60, random() % CHUNK_SIZE, int(random() % 120) - 60);
+    god.createEntity(Entity("e" + std::to_string(i), position, (random() % 628) / 100.0f, glm::vec3(0)));
+  }
+  // behind the entities looking across them, which the camera starts facing along +x
+  camera.SetCameraEyePosition(-45, 4, 0);
+  glm::vec3 eye = glm::vec3(0, 40, 0);
+  auto frame = [&]() {
+    god.drawEntities(scene, eye);
+    scene.draw();
+  };
+  for (int warmup = 0; warmup < 5; warmup += 1) {
+    frame();
+  }
+
+  resetStubCalls();
+  double submitSeconds = 0;
+  double drawSeconds = 0;
+  size_t stateChanges = 0;
+  for (int i = 0; i < FRAMES; i += 1) {
+    auto start = std::chrono::steady_clock::now();
+    god.drawEntities(scene, eye);
+    submitSeconds += secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    scene.draw();
+    drawSeconds += secondsSince(start);
+    stateChanges += scene.getFrameStats().stateChanges;
+  }
+  long draws = stubCalls("glDrawElements") + stubCalls("glDrawElementsInstanced") + stubCalls("glMultiDrawElementsBaseVertex");
+  printf("%d entities, per frame: drawEntities %.0f us, draw() %.0f us, %.1f state changes\n",
+    ENTITIES, submitSeconds / FRAMES * 1e6, drawSeconds / FRAMES * 1e6, double(stateChanges) / FRAMES);
+  printf("per frame: %.1f GL calls, %.1f draws, %.0f KB uploaded\n",
+    double(stubCalls()) / FRAMES, double(draws) / FRAMES, stubBufferBytes() / 1024.0 / FRAMES);
+  return 0;
+}
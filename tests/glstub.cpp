@@ -0,0 +1,158 @@
+#include "glstub.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <utility>
+
+// more than the functions glad loads up to OpenGL 3.3
+const int STUB_SLOTS = 1024;
+
+long calls[STUB_SLOTS];
+long bufferBytes = 0;
+GLuint nextName = 1;
+// the slot each loaded name counts its calls in
+std::map<std::string, int> slots;
+
+// the functions whose results the scene reads, each counting in a fixed slot. the rest take
+// slots from after these in the order glad loads them
+enum SpecialSlot {
+  GET_STRING, GET_STRINGI, GET_INTEGERV, GEN_BUFFERS, GEN_TEXTURES, GEN_VERTEX_ARRAYS,
+  CREATE_PROGRAM, CREATE_SHADER, GET_SHADERIV, GET_PROGRAMIV, GET_UNIFORM_LOCATION,
+  BUFFER_DATA, BUFFER_SUB_DATA, SPECIAL_SLOTS
+};
+
+const GLubyte* APIENTRY getString(GLenum) {
+  calls[GET_STRING] += 1;
+  return (const GLubyte*)"3.3.0 stub";
+}
+
+const GLubyte* APIENTRY getStringi(GLenum, GLuint) {
+  calls[GET_STRINGI] += 1;
+  return (const GLubyte*)"GL_STUB_extension";
+}
+
+// glad counts extensions through this, and gives up loading if there are none
+void APIENTRY getIntegerv(GLenum, GLint* data) {
+  calls[GET_INTEGERV] += 1;
+  *data = 1;
+}
+
+template <int SLOT>
+void APIENTRY generateNames(GLsizei count, GLuint* names) {
+  calls[SLOT] += 1;
+  for (GLsizei i = 0; i < count; i += 1) {
+    names[i] = nextName++;
+  }
+}
+
+GLuint APIENTRY createProgram() {
+  calls[CREATE_PROGRAM] += 1;
+  return nextName++;
+}
+
+GLuint APIENTRY createShader(GLenum) {
+  calls[CREATE_SHADER] += 1;
+  return nextName++;
+}
+
+// every status is success
+template <int SLOT>
+void APIENTRY getObjectiv(GLuint, GLenum, GLint* value) {
+  calls[SLOT] += 1;
+  *value = 1;
+}
+
+GLint APIENTRY getUniformLocation(GLuint, const GLchar*) {
+  calls[GET_UNIFORM_LOCATION] += 1;
+  return 1;
+}
+
+void APIENTRY bufferData(GLenum, GLsizeiptr size, const void*, GLenum) {
+  calls[BUFFER_DATA] += 1;
+  bufferBytes += size;
+}
+
+void APIENTRY bufferSubData(GLenum, GLintptr, GLsizeiptr size, const void*) {
+  calls[BUFFER_SUB_DATA] += 1;
+  bufferBytes += size;
+}
+
+const std::pair<const char*, void*> SPECIAL_STUBS[SPECIAL_SLOTS] = {
+  {"glGetString", (void*)&getString},
+  {"glGetStringi", (void*)&getStringi},
+  {"glGetIntegerv", (void*)&getIntegerv},
+  {"glGenBuffers", (void*)&generateNames<GEN_BUFFERS>},
+  {"glGenTextures", (void*)&generateNames<GEN_TEXTURES>},
+  {"glGenVertexArrays", (void*)&generateNames<GEN_VERTEX_ARRAYS>},
+  {"glCreateProgram", (void*)&createProgram},
+  {"glCreateShader", (void*)&createShader},
+  {"glGetShaderiv", (void*)&getObjectiv<GET_SHADERIV>},
+  {"glGetProgramiv", (void*)&getObjectiv<GET_PROGRAMIV>},
+  {"glGetUniformLocation", (void*)&getUniformLocation},
+  {"glBufferData", (void*)&bufferData},
+  {"glBufferSubData", (void*)&bufferSubData},
+};
+
+// the rest only count their calls. taking more arguments than any of them passes, in integer
+// registers or on the stack, and returning zero suits every one the scene calls
+template <int SLOT>
+long APIENTRY countCall(long, long, long, long, long, long) {
+  calls[SLOT] += 1;
+  return 0;
+}
+
+template <size_t... SLOT>
+std::array<void*, sizeof...(SLOT)> countingStubs(std::index_sequence<SLOT...>) {
+  return {{(void*)&countCall<SLOT>...}};
+}
+
+const std::array<void*, STUB_SLOTS> COUNTING_STUBS = countingStubs(std::make_index_sequence<STUB_SLOTS>());
+
+void* loadStub(const char* name) {
+  auto found = slots.find(name);
+  int slot;
+  if (found != slots.end()) {
+    slot = found->second;
+  } else {
+    slot = SPECIAL_SLOTS + int(slots.size());
+    for (int i = 0; i < SPECIAL_SLOTS; i += 1) {
+      if (std::string(SPECIAL_STUBS[i].first) == name) {
+        slot = i;
+      }
+    }
+    if (slot >= STUB_SLOTS) {
+      return nullptr;
+    }
+    slots[name] = slot;
+  }
+  return slot < SPECIAL_SLOTS ? SPECIAL_STUBS[slot].second : COUNTING_STUBS[slot];
+}
+
+bool loadStubGL() {
+  bool loaded = gladLoadGLLoader(loadStub) != 0;
+  resetStubCalls();
+  return loaded;
+}
+
+long stubCalls(const std::string &name) {
+  auto found = slots.find(name);
+  return found == slots.end() ? 0 : calls[found->second];
+}
+
+long stubCalls() {
+  long total = 0;
+  for (long count : calls) {
+    total += count;
+  }
+  return total;
+}
+
+long stubBufferBytes() {
+  return bufferBytes;
+}
+
+void resetStubCalls() {
+  std::fill(std::begin(calls), std::end(calls), 0);
+  bufferBytes = 0;
+}
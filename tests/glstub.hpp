@@ -0,0 +1,17 @@
+#ifndef GLSTUB_H
+#define GLSTUB_H
+#include <string>
+
+// load OpenGL through glad from stand-ins that draw nothing, so the scene can run without a
+// window or a GPU. names and buffers are handed out, shaders compile and uniforms are found,
+// and every call is counted by the name it was loaded as
+bool loadStubGL();
+// how many times a function was called since loading or the last reset
+long stubCalls(const std::string &name);
+// every call to any function since loading or the last reset
+long stubCalls();
+// the bytes given to glBufferData and glBufferSubData since loading or the last reset
+long stubBufferBytes();
+void resetStubCalls();
+
+#endif
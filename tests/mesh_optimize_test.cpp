@@ -0,0 +1,186 @@
+#include "World.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <unordered_set>
+
+// a UV sphere of quads, with the poles closed by fans of triangles
+OBJModel sphere(int rings, int segments) {
+  OBJModel model;
+  model.vertexNormals.push_back(glm::vec3(0, 1, 0));
+  auto corner = [&](int ring, int segment) {
+    float theta = glm::pi<float>() * ring / rings;
+    float phi = glm::two_pi<float>() * (segment % segments) / segments;
+    model.vertices.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+    model.vertexNormals.push_back(model.vertices.back());
+    int index = model.vertices.size() - 1;
+    return VertexDescriptor{index, index + 1, 0};
+  };
+  for (int ring = 0; ring < rings; ring += 1) {
+    for (int segment = 0; segment < segments; segment += 1) {
+      Face face;
+      face.vertexDescriptors.push_back(corner(ring, segment));
+      face.vertexDescriptors.push_back(corner(ring + 1, segment));
+      face.vertexDescriptors.push_back(corner(ring + 1, segment + 1));
+      if (ring > 0 && ring < rings - 1) {
+        face.vertexDescriptors.push_back(corner(ring, segment + 1));
+      }
+      model.faces.push_back(face);
+    }
+  }
+  return model;
+}
+
+typedef std::array<float, 9> Triangle;
+
+// the triangles of an encoded mesh by the positions of their corners, each starting from its
+// smallest corner so that the winding is kept but not where it starts
+std::vector<Triangle> triangles(const std::vector<VBOVertex> &data, const std::vector<GLuint> &indices) {
+  std::vector<Triangle> result;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    std::array<std::array<float, 3>, 3> corners;
+    for (int c = 0; c < 3; c += 1) {
+      const VBOVertex &v = data[indices[i + c]];
+      corners[c] = {v.x, v.y, v.z};
+    }
+    int first = std::min_element(corners.begin(), corners.end()) - corners.begin();
+    Triangle triangle;
+    for (int c = 0; c < 3; c += 1) {
+      std::copy(corners[(first + c) % 3].begin(), corners[(first + c) % 3].end(), triangle.begin() + c * 3);
+    }
+    result.push_back(triangle);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// vertices transformed per triangle through a FIFO post-transform cache
+float averageCacheMissRatio(const std::vector<GLuint> &indices, size_t cacheSize = 16) {
+  std::deque<GLuint> cache;
+  size_t misses = 0;
+  for (GLuint index : indices) {
+    if (std::find(cache.begin(), cache.end(), index) != cache.end()) {
+      continue;
+    }
+    misses += 1;
+    cache.push_back(index);
+    if (cache.size() > cacheSize) {
+      cache.pop_front();
+    }
+  }
+  return float(misses) / (indices.size() / 3);
+}
+
+void testHash() {
+  std::hash<VBOVertex> hash;
+  VBOVertex zero(glm::vec3(0), glm::vec3(0, 1, 0), glm::vec2(0));
+  VBOVertex negativeZero(glm::vec3(-0.0f, 0, -0.0f), glm::vec3(-0.0f, 1, 0), glm::vec2(0, -0.0f));
+  CHECK(zero == negativeZero);
+  CHECK(hash(zero) == hash(negativeZero));
+  // vertices a fraction of a unit apart still spread over the buckets
+  std::unordered_set<VBOVertex> vertices;
+  for (int y = 0; y < 100; y += 1) {
+    for (int x = 0; x < 100; x += 1) {
+      vertices.insert(VBOVertex(glm::vec3(x * 0.01f, y * 0.01f, 0), glm::vec3(0, 0, 1), glm::vec2(x * 0.01f, y * 0.01f)));
+    }
+  }
+  CHECK(vertices.size() == 10000);
+  size_t largestBucket = 0;
+  for (size_t bucket = 0; bucket < vertices.bucket_count(); bucket += 1) {
+    largestBucket = std::max(largestBucket, vertices.bucket_size(bucket));
+  }
+  CHECK(largestBucket <= 8);
+}
+
+// encoding shares equal corners and splits larger faces into fans
+void testEncode() {
+  OBJModel model = sphere(16, 32);
+  std::vector<VBOVertex> data;
+  std::vector<GLuint> indices;
+  CHECK(encodeOBJ(model, data, indices));
+  // the seam and pole corners are distinct positions only once
+  std::unordered_set<VBOVertex> distinct;
+  size_t corners = 0;
+  size_t expectedTriangles = 0;
+  for (const Face &face : model.faces) {
+    for (const VertexDescriptor &vd : face.vertexDescriptors) {
+      distinct.insert(VBOVertex(model.vertices[vd.vertex], model.vertexNormals[vd.vertexNormal], glm::vec2(0)));
+      corners += 1;
+    }
+    expectedTriangles += face.vertexDescriptors.size() - 2;
+  }
+  CHECK(data.size() == distinct.size());
+  CHECK(data.size() < corners);
+  CHECK(indices.size() == expectedTriangles * 3);
+  // a face with an index out of range is refused
+  model.faces[0].vertexDescriptors[0].vertex = model.vertices.size();
+  data.clear();
+  indices.clear();
+  CHECK(!encodeOBJ(model, data, indices));
+}
+
+// reordering keeps every triangle and its winding, and brings shuffled triangles back to
+// better than any order they started in
+void testVertexCache() {
+  std::vector<VBOVertex> data;
+  std::vector<GLuint> indices;
+  CHECK(encodeOBJ(sphere(48, 96), data, indices));
+  std::vector<Triangle> original = triangles(data, indices);
+  float inOrder = averageCacheMissRatio(indices);
+  std::vector<std::array<GLuint, 3>> shuffled;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    shuffled.push_back({indices[i], indices[i + 1], indices[i + 2]});
+  }
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(7));
+  indices.clear();
+  for (auto &triangle : shuffled) {
+    indices.insert(indices.end(), triangle.begin(), triangle.end());
+  }
+  float before = averageCacheMissRatio(indices);
+  optimizeVertexCache(indices, data.size());
+  float after = averageCacheMissRatio(indices);
+  CHECK(triangles(data, indices) == original);
+  CHECK(before > 1.5f);
+  CHECK(after < inOrder);
+  CHECK(after < 0.8f);
+
+  std::vector<GLuint> cacheOrder = indices;
+  optimizeOverdraw(indices, data);
+  CHECK(triangles(data, indices) == original);
+  // clusters only cut where the cache is cold or within the threshold of their own ratio
+  CHECK(averageCacheMissRatio(indices) <= averageCacheMissRatio(cacheOrder) * 1.05f + 0.01f);
+}
+
+// an optimized model draws the same triangles, and its vertices come in the order they're used
+void testOptimizeOBJ() {
+  for (OBJModel model : {UNIT_CUBE(), sphere(24, 48)}) {
+    std::vector<VBOVertex> data;
+    std::vector<GLuint> indices;
+    CHECK(encodeOBJ(model, data, indices));
+    OBJModel optimized = optimizeOBJ(model);
+    std::vector<VBOVertex> optimizedData;
+    std::vector<GLuint> optimizedIndices;
+    CHECK(encodeOBJ(optimized, optimizedData, optimizedIndices));
+    CHECK(triangles(optimizedData, optimizedIndices) == triangles(data, indices));
+    CHECK(optimizedData.size() == data.size());
+    for (const Face &face : optimized.faces) {
+      CHECK(face.vertexDescriptors.size() == 3);
+    }
+    GLuint next = 0;
+    bool firstUseOrder = true;
+    for (GLuint index : optimizedIndices) {
+      firstUseOrder = firstUseOrder && index <= next;
+      next = std::max(next, index + 1);
+    }
+    CHECK(firstUseOrder);
+  }
+}
+
+int main() {
+  testHash();
+  testEncode();
+  testVertexCache();
+  testOptimizeOBJ();
+  return checkResult("mesh_optimize_test");
+}
@@ -0,0 +1,139 @@
+#include "World.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// every allocation of the process, from any thread, goes through these
+std::atomic<long> allocations = {0};
+
+void* operator new(size_t size) {
+  allocations += 1;
+  void* memory = malloc(size > 0 ? size : 1);
+  if (memory == nullptr) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+  free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+  free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+  free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+  free(memory);
+}
+
+const int RADIUS = 8;
+const int CHUNKS_PER_ROUND = 200;
+const int ROUNDS = 40;
+// rounds before this one warm the pools up and are left out of the average
+const int STEADY_ROUND = 20;
+
+// the level of detail RenderGod would mesh a chunk at, seen from the origin
+int levelOfDetail(glm::ivec3 chunkCoordinate) {
+  return levelForDistance(glm::length(glm::vec3(chunkCoordinate)));
+}
+
+// remesh rounds of chunks of the noise world on one worker, the way an update after the
+// player moves does, and count the allocations each remesh makes once the pools are warm
+int main() {
+  ChunkGenerator* generator = createChunkGenerator("noise", 12345);
+  World world(12345);
+  int generated = RADIUS + 1;
+  for (int z = -generated; z <= generated; z += 1) {
+    for (int y = -generated; y <= generated; y += 1) {
+      for (int x = -generated; x <= generated; x += 1) {
+        world.setChunk(glm::ivec3(x, y, z), generator->generateChunk(glm::ivec3(x, y, z)));
+      }
+    }
+  }
+  std::vector<glm::ivec3> chunks;
+  for (int z = -RADIUS; z <= RADIUS; z += 1) {
+    for (int y = -RADIUS; y <= RADIUS; y += 1) {
+      for (int x = -RADIUS; x <= RADIUS; x += 1) {
+        if (glm::length(glm::vec3(x, y, z)) <= RADIUS) {
+          chunks.push_back(glm::ivec3(x, y, z));
+        }
+      }
+    }
+  }
+
+  MeshWorkers workers(1);
+  std::vector<MeshJob*> batch;
+  // the drawing thread keeps a face table for every chunk at full resolution
+  std::unordered_map<glm::ivec3, ChunkFaceTable> faceTables;
+  for (glm::ivec3 chunkCoordinate : chunks) {
+    faceTables[chunkCoordinate];
+  }
+  long steadyAllocations = 0;
+  double steadySeconds = 0;
+  size_t next = 0;
+  for (int round = 0; round < ROUNDS; round += 1) {
+    long allocationsBefore = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < CHUNKS_PER_ROUND; i += 1) {
+      glm::ivec3 chunkCoordinate = chunks[next];
+      next = (next + 1) % chunks.size();
+      int level = levelOfDetail(chunkCoordinate);
+      MeshJob* job = workers.newJob();
+      job->chunkCoordinate = chunkCoordinate;
+      job->level = level;
+      job->version = round + 1;
+      memcpy(job->chunk.blocks, world.getChunk(chunkCoordinate).blocks, sizeof(job->chunk.blocks));
+      job->found = 0;
+      for (int d = 0; d < 6; d += 1) {
+        glm::ivec3 neighbor = chunkCoordinate + ORTHO_DIRS[d];
+        if (levelOfDetail(neighbor) == level) {
+          memcpy(job->neighbors[d].blocks, world.getChunk(neighbor).blocks, sizeof(job->neighbors[d].blocks));
+          job->found |= 1 << d;
+        }
+      }
+      job->queued = std::chrono::steady_clock::now();
+      batch.push_back(job);
+    }
+    workers.submit(batch);
+    int received = 0;
+    while (received < CHUNKS_PER_ROUND) {
+      MeshResult* result = workers.nextResult();
+      if (result == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (result->level == 0) {
+        faceTables[result->chunkCoordinate].build(result->faces);
+      }
+      workers.recycle(result);
+      received += 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long roundAllocations = allocations - allocationsBefore;
+    if (round == 0 || round == STEADY_ROUND - 1) {
+      printf("round %2d: %.2f allocations per remesh, %.0f us per remesh\n",
+        round, double(roundAllocations) / CHUNKS_PER_ROUND, seconds * 1e6 / CHUNKS_PER_ROUND);
+    }
+    if (round >= STEADY_ROUND) {
+      steadyAllocations += roundAllocations;
+      steadySeconds += seconds;
+    }
+  }
+  int steadyRemeshes = (ROUNDS - STEADY_ROUND) * CHUNKS_PER_ROUND;
+  printf("rounds %d-%d: %.2f allocations per remesh, %.0f us per remesh\n", STEADY_ROUND, ROUNDS - 1,
+    double(steadyAllocations) / steadyRemeshes, steadySeconds * 1e6 / steadyRemeshes);
+  delete generator;
+  return 0;
+}
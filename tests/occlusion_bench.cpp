@@ -0,0 +1,156 @@
+#include "World.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+const int RADIUS = 6;
+const int EYES = 4;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// a block two above the ground, or an air block under it, in a random chunk near the origin
+bool pickEye(World &world, std::mt19937 &random, bool underground, glm::ivec3 &eyeBlock) {
+  glm::ivec3 eyeChunk(int(random() % 5) - 2, underground ? -3 - int(random() % 2) : 0, int(random() % 5) - 2);
+  if (underground) {
+    Chunk &chunk = world.getChunk(eyeChunk);
+    for (int attempt = 0; attempt < CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE; attempt += 1) {
+      glm::ivec3 block(random() % CHUNK_SIZE, random() % CHUNK_SIZE, random() % CHUNK_SIZE);
+      if (chunk.blocks[block.z][block.y][block.x] == BLOCKTYPE_AIR) {
+        eyeBlock = eyeChunk * CHUNK_SIZE + block;
+        return true;
+      }
+    }
+    return false;
+  }
+  glm::ivec3 block(eyeChunk.x * CHUNK_SIZE + int(random() % CHUNK_SIZE), 3 * CHUNK_SIZE, eyeChunk.z * CHUNK_SIZE + int(random() % CHUNK_SIZE));
+  while (block.y > -3 * CHUNK_SIZE && world.getBlock(block) == BLOCKTYPE_AIR) {
+    block.y -= 1;
+  }
+  eyeBlock = block + glm::ivec3(0, 2, 0);
+  return true;
+}
+
+// the quads RenderGod::hideSealedChunks draws for the chunks the path search reached
+std::vector<glm::vec3> sealedOccluders(const std::unordered_map<glm::ivec3, ChunkConnections> &connections,
+    const ChunkPathSearch &search, glm::ivec3 eyeChunk) {
+  std::vector<glm::vec3> occluders;
+  for (auto &entry : connections) {
+    if (search.reached(entry.first)) {
+      appendOccluders(entry.first, entry.second, eyeChunk, occluders);
+    }
+  }
+  return occluders;
+}
+
+// from a few eyes on and under the surface of each generator, draw the occluders the scene
+// would, time drawing them and testing every chunk mesh in view against them, and cast a ray
+// through every few pixels to count any that first hit a block in a chunk the buffer hid
+int main() {
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f), 640.0f / 480, 0.1f, 40.0f);
+  for (std::string name : {"noise", "simplex"}) {
+    ChunkGenerator* generator = createChunkGenerator(name, 12345);
+    World world(12345);
+    int generated = RADIUS + 3;
+    for (int z = -generated; z <= generated; z += 1) {
+      for (int y = -generated; y <= generated; y += 1) {
+        for (int x = -generated; x <= generated; x += 1) {
+          world.setChunk(glm::ivec3(x, y, z), generator->generateChunk(glm::ivec3(x, y, z)));
+        }
+      }
+    }
+    for (bool underground : {false, true}) {
+      std::mt19937 random(underground ? 2 : 1);
+      double rasterSeconds = 0;
+      double testSeconds = 0;
+      size_t views = 0, occluderQuads = 0, inView = 0, hidden = 0, rays = 0, raysIntoHidden = 0;
+      for (int eye = 0; eye < EYES; eye += 1) {
+        glm::ivec3 eyeBlock;
+        if (!pickEye(world, random, underground, eyeBlock)) {
+          continue;
+        }
+        glm::ivec3 eyeChunk = World::blockToChunkCoordinate(eyeBlock);
+        std::unordered_map<glm::ivec3, ChunkConnections> connections;
+        std::unordered_map<glm::ivec3, AABB> bounds;
+        for (int z = -RADIUS; z <= RADIUS; z += 1) {
+          for (int y = -RADIUS; y <= RADIUS; y += 1) {
+            for (int x = -RADIUS; x <= RADIUS; x += 1) {
+              glm::ivec3 chunkCoordinate = eyeChunk + glm::ivec3(x, y, z);
+              if (glm::length(glm::vec3(x, y, z)) > RADIUS) {
+                continue;
+              }
+              Chunk &chunk = world.getChunk(chunkCoordinate);
+              connections[chunkCoordinate] = chunk.calculateConnections();
+              Chunk* neighbors[6];
+              for (int d = 0; d < 6; d += 1) {
+                neighbors[d] = &world.getChunk(chunkCoordinate + ORTHO_DIRS[d]);
+              }
+              RenderCache cache;
+              chunk.calculateChunkMesh(chunkCoordinate, neighbors, cache);
+              if (!cache.chunkVertices.empty()) {
+                bounds[chunkCoordinate] = cacheBounds(cache);
+              }
+            }
+          }
+        }
+        ChunkPathSearch search;
+        search.search(connections, eyeChunk, eyeChunk, RADIUS + 1);
+        std::vector<glm::vec3> occluders = sealedOccluders(connections, search, eyeChunk);
+        occluderQuads += occluders.size() / 4;
+        glm::vec3 eyePosition = glm::vec3(eyeBlock) * BLOCK_SCALE;
+        OcclusionBuffer buffer(OCCLUSION_WIDTH, OCCLUSION_WIDTH * 480 / 640);
+        for (int yaw = 0; yaw < 8; yaw += 1) {
+          for (float pitch : {0.0f, -0.35f}) {
+            float angle = yaw * glm::quarter_pi<float>();
+            glm::vec3 forward(std::cos(angle) * std::cos(pitch), std::sin(pitch), std::sin(angle) * std::cos(pitch));
+            glm::mat4 projectionView = projection * glm::lookAt(eyePosition, eyePosition + forward, glm::vec3(0, 1, 0));
+            Frustum frustum = extractFrustum(projectionView);
+            auto start = std::chrono::steady_clock::now();
+            const int REPEATS = 20;
+            for (int repeat = 0; repeat < REPEATS; repeat += 1) {
+              buffer.clear(projectionView);
+              for (size_t i = 0; i + 4 <= occluders.size(); i += 4) {
+                buffer.rasterizeQuad(&occluders[i]);
+              }
+            }
+            rasterSeconds += secondsSince(start) / REPEATS;
+            std::unordered_set<glm::ivec3> hiddenChunks;
+            start = std::chrono::steady_clock::now();
+            for (auto &entry : bounds) {
+              if (!search.reached(entry.first) || !intersectsFrustum(frustum, entry.second)) {
+                continue;
+              }
+              inView += 1;
+              if (!buffer.visible(entry.second)) {
+                hiddenChunks.insert(entry.first);
+              }
+            }
+            testSeconds += secondsSince(start);
+            hidden += hiddenChunks.size();
+            views += 1;
+            glm::mat4 inverse = glm::inverse(projectionView);
+            for (int y = 0; y < 48; y += 1) {
+              for (int x = 0; x < 64; x += 1) {
+                glm::vec4 far = inverse * glm::vec4((x + 0.5f) / 32 - 1, (y + 0.5f) / 24 - 1, 1, 1);
+                glm::vec3 direction = glm::normalize(glm::vec3(far) / far.w - eyePosition);
+                glm::ivec3 hit, before;
+                rays += 1;
+                if (world.castRay(glm::vec3(eyeBlock), direction, RADIUS * CHUNK_SIZE, hit, before)) {
+                  raysIntoHidden += hiddenChunks.count(World::blockToChunkCoordinate(hit));
+                }
+              }
+            }
+          }
+        }
+      }
+      views = std::max<size_t>(views, 1);
+      printf("%-7s %-11s %4zu occluders, raster %5.0f us, test %4.0f us, hid %zu of %zu chunk meshes in view (%.1f%%), %zu of %zu rays into hidden chunks\n",
+        name.c_str(), underground ? "underground" : "surface", occluderQuads, rasterSeconds / views * 1e6,
+        testSeconds / views * 1e6, hidden, inView, 100.0 * hidden / std::max<size_t>(inView, 1), raysIntoHidden, rays);
+    }
+    delete generator;
+  }
+  return 0;
+}
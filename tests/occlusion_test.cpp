@@ -0,0 +1,189 @@
+#include "World.hpp"
+#include "check.hpp"
+#include <cfloat>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+
+const int WIDTH = 128;
+const int HEIGHT = 96;
+
+// looking down -z from the origin, at a 4 by 4 wall 10 units away in the middle of the view
+const glm::vec3 WALL[4] = {{-2, -2, -10}, {2, -2, -10}, {2, 2, -10}, {-2, 2, -10}};
+
+glm::mat4 wallView() {
+  glm::mat4 projection = glm::perspective(glm::radians(45.0f), 640.0f / 480, 0.1f, 40.0f);
+  return projection * glm::lookAt(glm::vec3(0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+}
+
+AABB box(glm::vec3 center, float halfSize) {
+  AABB result;
+  result.min = center - halfSize;
+  result.max = center + halfSize;
+  return result;
+}
+
+// a point in world space as the buffer draws it: x and y in pixels and z / w
+glm::vec3 toScreen(const glm::mat4 &projectionView, glm::vec3 point) {
+  glm::vec4 clip = projectionView * glm::vec4(point, 1);
+  return glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * WIDTH, (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT, clip.z / clip.w);
+}
+
+// pixels well inside the wall hold its depth, and pixels well outside it stay empty
+void testWallDepths() {
+  glm::mat4 projectionView = wallView();
+  OcclusionBuffer buffer(WIDTH, HEIGHT);
+  CHECK(buffer.getWidth() == WIDTH);
+  CHECK(buffer.getHeight() == HEIGHT);
+  buffer.clear(projectionView);
+  buffer.rasterizeQuad(WALL);
+  glm::vec3 low = toScreen(projectionView, WALL[0]);
+  glm::vec3 high = toScreen(projectionView, WALL[2]);
+  float wallDepth = low.z;
+  int inside = 0;
+  int outside = 0;
+  int wrongInside = 0;
+  int wrongOutside = 0;
+  for (int y = 0; y < HEIGHT; y += 1) {
+    for (int x = 0; x < WIDTH; x += 1) {
+      float centerX = x + 0.5f;
+      float centerY = y + 0.5f;
+      if (centerX > low.x + 1 && centerX < high.x - 1 && centerY > low.y + 1 && centerY < high.y - 1) {
+        inside += 1;
+        wrongInside += std::fabs(buffer.getDepth(x, y) - wallDepth) > 1e-5f;
+      } else if (centerX < low.x - 1 || centerX > high.x + 1 || centerY < low.y - 1 || centerY > high.y + 1) {
+        outside += 1;
+        wrongOutside += buffer.getDepth(x, y) != FLT_MAX;
+      }
+    }
+  }
+  CHECK(inside > 1000);
+  CHECK(outside > 1000);
+  CHECK(wrongInside == 0);
+  CHECK(wrongOutside == 0);
+
+  // a nearer quad in front of part of the wall keeps the nearest depth
+  glm::vec3 panel[4] = {{-0.5f, -0.5f, -5}, {0.5f, -0.5f, -5}, {0.5f, 0.5f, -5}, {-0.5f, 0.5f, -5}};
+  buffer.rasterizeQuad(panel);
+  float panelDepth = toScreen(projectionView, panel[0]).z;
+  CHECK(std::fabs(buffer.getDepth(WIDTH / 2, HEIGHT / 2) - panelDepth) < 1e-5f);
+  // a farther one changes nothing
+  glm::vec3 far[4] = {{-20, -20, -30}, {20, -20, -30}, {20, 20, -30}, {-20, 20, -30}};
+  buffer.rasterizeQuad(far);
+  CHECK(std::fabs(buffer.getDepth(WIDTH / 2, HEIGHT / 2) - panelDepth) < 1e-5f);
+  CHECK(std::fabs(buffer.getDepth(int(low.x) + 2, int(low.y) + 2) - wallDepth) < 1e-5f);
+
+  // a quad reaching behind the eye is left out
+  buffer.clear(projectionView);
+  glm::vec3 floor[4] = {{-5, -1, 5}, {5, -1, 5}, {5, -1, -10}, {-5, -1, -10}};
+  buffer.rasterizeQuad(floor);
+  int drawn = 0;
+  for (int y = 0; y < HEIGHT; y += 1) {
+    for (int x = 0; x < WIDTH; x += 1) {
+      drawn += buffer.getDepth(x, y) != FLT_MAX;
+    }
+  }
+  CHECK(drawn == 0);
+}
+
+void testWallVisibility() {
+  glm::mat4 projectionView = wallView();
+  OcclusionBuffer buffer(WIDTH, HEIGHT);
+  buffer.clear(projectionView);
+  // nothing is hidden behind an empty buffer
+  CHECK(buffer.visible(box(glm::vec3(0, 0, -20), 1)));
+  buffer.rasterizeQuad(WALL);
+  CHECK(!buffer.visible(box(glm::vec3(0, 0, -20), 1)));
+  // past the wall's edge
+  CHECK(buffer.visible(box(glm::vec3(6, 0, -20), 1)));
+  // partly past the wall's edge
+  CHECK(buffer.visible(box(glm::vec3(4, 0, -20), 1.5f)));
+  // in front of the wall
+  CHECK(buffer.visible(box(glm::vec3(0, 0, -5), 1)));
+  // reaching behind the near plane
+  CHECK(buffer.visible(box(glm::vec3(0), 1)));
+  // through the wall
+  CHECK(buffer.visible(box(glm::vec3(0, 0, -10), 0.5f)));
+}
+
+// a box is only ever reported hidden when every point of it on screen is behind the wall
+void testConservative() {
+  glm::mat4 projectionView = wallView();
+  Frustum frustum = extractFrustum(projectionView);
+  OcclusionBuffer buffer(WIDTH, HEIGHT);
+  buffer.clear(projectionView);
+  buffer.rasterizeQuad(WALL);
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> unit(0, 1);
+  int hidden = 0;
+  int wrong = 0;
+  for (int i = 0; i < 20000; i += 1) {
+    glm::vec3 center(unit(random) * 12 - 6, unit(random) * 12 - 6, -12 - unit(random) * 24);
+    float halfSize = 0.2f + unit(random) * 1.6f;
+    AABB tested = box(center, halfSize);
+    if (!intersectsFrustum(frustum, tested) || buffer.visible(tested)) {
+      continue;
+    }
+    hidden += 1;
+    bool seen = false;
+    for (int sample = 0; sample < 200 && !seen; sample += 1) {
+      glm::vec3 point = tested.min + glm::vec3(unit(random), unit(random), unit(random)) * (halfSize * 2);
+      glm::vec4 clip = projectionView * glm::vec4(point, 1);
+      if (std::fabs(clip.x) > clip.w || std::fabs(clip.y) > clip.w) {
+        continue;
+      }
+      // where the line from the eye to the point crosses the wall's plane
+      glm::vec3 crossing = point * (-10.0f / point.z);
+      seen = std::fabs(crossing.x) > 2 || std::fabs(crossing.y) > 2;
+    }
+    wrong += seen;
+  }
+  CHECK(hidden > 1000);
+  CHECK(wrong == 0);
+}
+
+// boxes behind a wall but wholly outside its outline on screen, by less than a pixel, stay
+// visible even where the wall covers the centres of the pixels they fall in
+void testPastTheEdge() {
+  glm::mat4 projectionView = wallView();
+  float tangent = std::tan(glm::radians(22.5f));
+  // a pixel across and up, as a slope of x or y over the distance in front of the eye
+  glm::vec2 pixel = glm::vec2(2.0f / WIDTH * tangent * 640 / 480, 2.0f / HEIGHT * tangent);
+  // edges 0.3 pixels past the centres of the pixels they cross, so the wall covers those centres
+  glm::vec2 edge = pixel * (glm::vec2(WIDTH, HEIGHT) * 0.5f - 16.2f);
+  glm::vec3 wall[4] = {
+    {-edge.x * 10, -edge.y * 10, -10}, {edge.x * 10, -edge.y * 10, -10},
+    {edge.x * 10, edge.y * 10, -10}, {-edge.x * 10, edge.y * 10, -10}};
+  OcclusionBuffer buffer(WIDTH, HEIGHT);
+  buffer.clear(projectionView);
+  buffer.rasterizeQuad(wall);
+  std::mt19937 random(3);
+  std::uniform_real_distribution<float> unit(0, 1);
+  int hidden = 0;
+  for (int i = 0; i < 2000; i += 1) {
+    float far = 12 + unit(random) * 25;
+    // small enough to fit in the rest of the pixel the edge crosses
+    float size = (0.01f + unit(random) * 0.05f) * pixel.x * far;
+    // past an edge on one axis at the box's farthest, and so at every point of it
+    int axis = i % 2;
+    int across = 1 - axis;
+    float side = i % 4 < 2 ? 1 : -1;
+    AABB tested;
+    tested.min.z = -far;
+    tested.max.z = -far + size;
+    float start = (edge[axis] + unit(random) * pixel[axis] * 0.2f) * far;
+    tested.min[axis] = side > 0 ? start : -start - size;
+    tested.max[axis] = tested.min[axis] + size;
+    tested.min[across] = (unit(random) * 1.2f - 0.6f) * edge[across] * (far - size);
+    tested.max[across] = tested.min[across] + size;
+    hidden += !buffer.visible(tested);
+  }
+  CHECK(hidden == 0);
+}
+
+int main() {
+  testWallDepths();
+  testWallVisibility();
+  testConservative();
+  testPastTheEdge();
+  return checkResult("occlusion_test");
+}
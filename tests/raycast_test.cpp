@@ -0,0 +1,140 @@
+#include "World.hpp"
+#include "check.hpp"
+#include <cstring>
+#include <random>
+
+// a world of air chunks around the origin, from -CHUNK_SIZE to CHUNK_SIZE - 1 blocks on each axis
+void fillAir(World &world) {
+  Chunk chunk;
+  memset(chunk.blocks, BLOCKTYPE_AIR, sizeof(chunk.blocks));
+  for (int z = -1; z <= 0; z += 1) {
+    for (int y = -1; y <= 0; y += 1) {
+      for (int x = -1; x <= 0; x += 1) {
+        world.setChunk(glm::ivec3(x, y, z), chunk);
+      }
+    }
+  }
+}
+
+bool solid(World &world, glm::ivec3 block) {
+  return world.hasBlock(block) && world.getBlock(block) != BLOCKTYPE_AIR;
+}
+
+// how far along a ray it enters a block, or -1 if it misses
+float entryDistance(glm::vec3 from, glm::vec3 direction, glm::ivec3 block) {
+  float enter = 0;
+  float leave = INFINITY;
+  for (int axis = 0; axis < 3; axis += 1) {
+    float lo = block[axis] - 0.5f;
+    float hi = block[axis] + 0.5f;
+    if (direction[axis] == 0) {
+      if (from[axis] < lo || from[axis] > hi) {
+        return -1;
+      }
+      continue;
+    }
+    float t1 = (lo - from[axis]) / direction[axis];
+    float t2 = (hi - from[axis]) / direction[axis];
+    enter = std::max(enter, std::min(t1, t2));
+    leave = std::min(leave, std::max(t1, t2));
+  }
+  return enter <= leave ? enter : -1;
+}
+
+int faceDistance(glm::ivec3 a, glm::ivec3 b) {
+  glm::ivec3 d = glm::abs(a - b);
+  return d.x + d.y + d.z;
+}
+
+void testStraightRay() {
+  World world(0);
+  fillAir(world);
+  world.setBlock(glm::ivec3(5, 0, 0), BLOCKTYPE_STONE);
+  glm::ivec3 hit, before;
+  CHECK(world.castRay(glm::vec3(0), glm::vec3(1, 0, 0), 8, hit, before));
+  CHECK(hit == glm::ivec3(5, 0, 0));
+  CHECK(before == glm::ivec3(4, 0, 0));
+  // out of reach
+  CHECK(!world.castRay(glm::vec3(0), glm::vec3(1, 0, 0), 4, hit, before));
+  // looking away
+  CHECK(!world.castRay(glm::vec3(0), glm::vec3(-1, 0, 0), 8, hit, before));
+}
+
+// a ray barely clipping the corner of a block still hits it
+void testGrazingRay() {
+  World world(0);
+  fillAir(world);
+  world.setBlock(glm::ivec3(0, 1, 0), BLOCKTYPE_STONE);
+  glm::ivec3 hit, before;
+  CHECK(world.castRay(glm::vec3(0), glm::vec3(1, 1.02f, 0), 8, hit, before));
+  CHECK(hit == glm::ivec3(0, 1, 0));
+  CHECK(before == glm::ivec3(0, 0, 0));
+}
+
+// a ray through an edge between blocks still reports a block beside the hit, not across from it
+void testEdgeRay() {
+  World world(0);
+  fillAir(world);
+  world.setBlock(glm::ivec3(1, 1, 0), BLOCKTYPE_STONE);
+  glm::ivec3 hit, before;
+  CHECK(world.castRay(glm::vec3(0), glm::vec3(1, 1, 0), 8, hit, before));
+  CHECK(hit == glm::ivec3(1, 1, 0));
+  CHECK(faceDistance(hit, before) == 1);
+}
+
+// on random rays through scattered blocks, the hit is the first solid block the ray enters,
+// going by a fine march along it, and before shares a face with it
+void testRandomRays() {
+  World world(0);
+  fillAir(world);
+  std::mt19937 random(12345);
+  std::uniform_int_distribution<int> coordinate(-CHUNK_SIZE, CHUNK_SIZE - 1);
+  for (int i = 0; i < 1500; i += 1) {
+    world.setBlock(glm::ivec3(coordinate(random), coordinate(random), coordinate(random)), BLOCKTYPE_STONE);
+  }
+  std::uniform_real_distribution<float> unit(-1, 1);
+  const float REACH = 8;
+  const float MARCH_STEP = 0.001f;
+  int hits = 0;
+  int wrongHits = 0;
+  int missedHits = 0;
+  int notBeside = 0;
+  for (int ray = 0; ray < 2000; ray += 1) {
+    glm::vec3 from = glm::vec3(unit(random), unit(random), unit(random)) * 6.0f;
+    glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+    glm::ivec3 start = glm::ivec3(glm::floor(from + 0.5f));
+    if (solid(world, start)) {
+      continue;
+    }
+    glm::ivec3 hit, before;
+    bool found = world.castRay(from, direction, REACH, hit, before);
+    float limit = REACH;
+    if (found) {
+      hits += 1;
+      float entry = entryDistance(from, direction, hit);
+      wrongHits += !solid(world, hit) || entry < 0 || entry > REACH;
+      notBeside += faceDistance(hit, before) != 1;
+      limit = entry;
+    }
+    // no solid block comes before the hit
+    for (float t = 0; t < limit - MARCH_STEP; t += MARCH_STEP) {
+      glm::ivec3 block = glm::ivec3(glm::floor(from + direction * t + 0.5f));
+      if (block != start && solid(world, block)) {
+        missedHits += 1;
+        break;
+      }
+    }
+  }
+  CHECK(hits > 100);
+  CHECK(wrongHits == 0);
+  CHECK(missedHits == 0);
+  CHECK(notBeside == 0);
+}
+
+int main() {
+  testStraightRay();
+  testGrazingRay();
+  testEdgeRay();
+  testRandomRays();
+  return checkResult("raycast_test");
+}
@@ -0,0 +1,125 @@
+#include "World.hpp"
+#include "check.hpp"
+#include <algorithm>
+#include <random>
+
+struct Draw {
+  RenderPass pass;
+  bool packed;
+  uint32_t material;
+  float distance;
+  uint64_t key;
+};
+
+std::vector<Draw> randomDraws(size_t count) {
+  std::mt19937 random(12345);
+  std::uniform_int_distribution<int> pass(0, RENDER_PASSES - 1);
+  std::uniform_int_distribution<uint32_t> material(0, 5);
+  // squared distances, from right at the camera to far past the view distance
+  std::uniform_real_distribution<float> distance(0, 100000);
+  std::vector<Draw> draws;
+  for (size_t i = 0; i < count; i += 1) {
+    Draw draw = {RenderPass(pass(random)), random() % 2 == 0, material(random), distance(random), 0};
+    // some draws at the same distance, and some right at the camera
+    if (i % 7 == 0 && i > 0) {
+      draw.distance = draws[i - 1].distance;
+    } else if (i % 11 == 0) {
+      draw.distance = 0;
+    }
+    draw.key = drawKey(draw.pass, draw.packed, draw.material, draw.distance);
+    draws.push_back(draw);
+  }
+  std::sort(draws.begin(), draws.end(), [](const Draw &a, const Draw &b) {
+    return a.key < b.key;
+  });
+  return draws;
+}
+
+void testPassOf() {
+  for (int pass = 0; pass < RENDER_PASSES; pass += 1) {
+    for (bool packed : {false, true}) {
+      for (uint32_t material : {0u, 1u, 0x1FFFFFFFu, 0xFFFFFFFFu}) {
+        for (float distance : {0.0f, 1.0f, 1e30f, INFINITY}) {
+          CHECK(drawKeyPass(drawKey(RenderPass(pass), packed, material, distance)) == pass);
+        }
+      }
+    }
+  }
+}
+
+// a sorted queue runs through the opaque pass, then cutout, then translucent
+void testPassOrder() {
+  std::vector<Draw> draws = randomDraws(5000);
+  int outOfOrder = 0;
+  for (size_t i = 1; i < draws.size(); i += 1) {
+    outOfOrder += draws[i - 1].pass > draws[i].pass;
+  }
+  CHECK(outOfOrder == 0);
+  // whatever else differs
+  CHECK(drawKey(PASS_OPAQUE, false, 0x1FFFFFFF, INFINITY) < drawKey(PASS_CUTOUT, true, 0, 0));
+  CHECK(drawKey(PASS_CUTOUT, false, 0x1FFFFFFF, INFINITY) < drawKey(PASS_TRANSLUCENT, true, 0, 0));
+  CHECK(drawKey(PASS_CUTOUT, false, 0x1FFFFFFF, 0) < drawKey(PASS_TRANSLUCENT, false, 0x1FFFFFFF, 0));
+}
+
+// within the opaque and cutout passes, packed meshes come first, each material's draws come
+// together, and those go from near to far
+void testSolidPasses() {
+  std::vector<Draw> draws = randomDraws(5000);
+  int packedAfter = 0;
+  int splitMaterials = 0;
+  int backToFront = 0;
+  for (RenderPass pass : {PASS_OPAQUE, PASS_CUTOUT}) {
+    std::vector<Draw> inPass;
+    std::copy_if(draws.begin(), draws.end(), std::back_inserter(inPass), [&](const Draw &draw) {
+      return draw.pass == pass;
+    });
+    CHECK(inPass.size() > 1000);
+    // the draws of a material are only ever started once per kind of mesh
+    std::vector<std::pair<bool, uint32_t>> started;
+    for (size_t i = 0; i < inPass.size(); i += 1) {
+      const Draw &draw = inPass[i];
+      bool sameGroup = i > 0 && inPass[i - 1].packed == draw.packed && inPass[i - 1].material == draw.material;
+      if (i > 0) {
+        packedAfter += draw.packed && !inPass[i - 1].packed;
+        backToFront += sameGroup && inPass[i - 1].distance > draw.distance;
+      }
+      if (!sameGroup) {
+        std::pair<bool, uint32_t> group = {draw.packed, draw.material};
+        splitMaterials += std::find(started.begin(), started.end(), group) != started.end();
+        started.push_back(group);
+      }
+    }
+  }
+  CHECK(packedAfter == 0);
+  CHECK(splitMaterials == 0);
+  CHECK(backToFront == 0);
+  CHECK(drawKey(PASS_OPAQUE, true, 0x1FFFFFFF, INFINITY) < drawKey(PASS_OPAQUE, false, 0, 0));
+  CHECK(drawKey(PASS_CUTOUT, true, 3, 1e6f) < drawKey(PASS_CUTOUT, true, 4, 0));
+  CHECK(drawKey(PASS_CUTOUT, true, 3, 1) < drawKey(PASS_CUTOUT, true, 3, 2));
+}
+
+// translucent draws go from far to near whatever their material, as they blend over each other
+void testTranslucentPass() {
+  std::vector<Draw> draws = randomDraws(5000);
+  int frontToBack = 0;
+  int translucent = 0;
+  for (size_t i = 1; i < draws.size(); i += 1) {
+    if (draws[i - 1].pass == PASS_TRANSLUCENT && draws[i].pass == PASS_TRANSLUCENT) {
+      translucent += 1;
+      frontToBack += draws[i - 1].distance < draws[i].distance;
+    }
+  }
+  CHECK(translucent > 1000);
+  CHECK(frontToBack == 0);
+  CHECK(drawKey(PASS_TRANSLUCENT, false, 5, 2) < drawKey(PASS_TRANSLUCENT, true, 0, 1));
+  // at the same distance, packed meshes still come first
+  CHECK(drawKey(PASS_TRANSLUCENT, true, 5, 1) < drawKey(PASS_TRANSLUCENT, false, 0, 1));
+}
+
+int main() {
+  testPassOf();
+  testPassOrder();
+  testSolidPasses();
+  testTranslucentPass();
+  return checkResult("render_queue_test");
+}
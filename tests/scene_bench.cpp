@@ -0,0 +1,87 @@
+#include "World.hpp"
+#include "glstub.hpp"
+#include <chrono>
+#include <cstdio>
+
+extern float PAN_FACTOR;
+
+const int MESHES = 10000;
+const int FRAMES = 360;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// draw a scene of 10,000 small packed meshes through the GL stub while turning the camera
+// once around, to time what draw() costs on the CPU and count what it asks of the GPU
+int main() {
+  if (!loadStubGL()) {
+    printf("could not load the GL stub\n");
+    return 1;
+  }
+  Camera camera;
+  Scene scene(640, 480, camera);
+  scene.setViewDistance(1000);
+  // a block at the middle of each chunk of a 22 x 21 x 22 grid, every tenth mesh hidden
+  std::vector<MeshHandle> handles;
+  auto start = std::chrono::steady_clock::now();
+  for (int z = -11; z < 11; z += 1) {
+    for (int y = -10; y < 11; y += 1) {
+      for (int x = -11; x < 11 && handles.size() < MESHES; x += 1) {
+        RenderCache cache;
+        cache.texture = "media/textures.ppm";
+        cache.tiled = true;
+        cache.origin = glm::vec3(x, y, z) * float(CHUNK_SIZE);
+        for (int d = 0; d < 6; d += 1) {
+          for (int corner = 0; corner < 4; corner += 1) {
+            cache.chunkVertices.push_back(ChunkVertex(glm::ivec3(CHUNK_SIZE / 2), d, BLOCKTYPE_STONE, corner));
+          }
+          cache.faceVertices[PASS_OPAQUE][d] = 4;
+        }
+        MeshHandle handle = scene.createMeshFromCache(cache);
+        if (handles.size() % 10 == 0) {
+          scene.hideMesh(handle);
+        }
+        handles.push_back(handle);
+      }
+    }
+  }
+  double createSeconds = secondsSince(start);
+  for (int frame = 0; frame < 10; frame += 1) {
+    scene.draw();
+  }
+
+  resetStubCalls();
+  FrameStats total;
+  double drawSeconds = 0;
+  for (int frame = 0; frame < FRAMES; frame += 1) {
+    camera.MouseLook(int(frame * 360 / PAN_FACTOR / FRAMES), 0);
+    start = std::chrono::steady_clock::now();
+    scene.draw();
+    drawSeconds += secondsSince(start);
+    FrameStats stats = scene.getFrameStats();
+    total.drawn += stats.drawn;
+    total.culled += stats.culled;
+    total.hidden += stats.hidden;
+    total.stateChanges += stats.stateChanges;
+  }
+  printf("%zu meshes created in %.1f ms\n", handles.size(), createSeconds * 1e3);
+  printf("per frame: draw() %.0f us, %.0f meshes drawn, %.0f culled, %.0f hidden, %.1f state changes\n",
+    drawSeconds / FRAMES * 1e6, double(total.drawn) / FRAMES, double(total.culled) / FRAMES,
+    double(total.hidden) / FRAMES, double(total.stateChanges) / FRAMES);
+  printf("per frame: %.1f GL calls, %.1f multi-draws, %.1f single draws, %.0f bytes uploaded\n",
+    double(stubCalls()) / FRAMES, double(stubCalls("glMultiDrawElementsBaseVertex")) / FRAMES,
+    double(stubCalls("glDrawElements")) / FRAMES, double(stubBufferBytes()) / FRAMES);
+
+  // the lookups RenderGod makes for every chunk when it hides sealed ones
+  const int ROUNDS = 100;
+  size_t found = 0;
+  start = std::chrono::steady_clock::now();
+  for (int round = 0; round < ROUNDS; round += 1) {
+    for (MeshHandle handle : handles) {
+      found += scene.getMesh(handle) != nullptr;
+    }
+  }
+  printf("%zu getMesh lookups: %.0f us, %zu found\n", handles.size(), secondsSince(start) / ROUNDS * 1e6, found / ROUNDS);
+  return 0;
+}